@@ -0,0 +1,119 @@
+# Profile-guided optimized build of the solver on Linux with GCC or Clang.
+#
+# For every value of PATHFINDER_PGO_MARCH three steps run inside one build tree:
+#   1. Volga-IT-Pathfinder-Training-<march> is the bench built with profile instrumentation
+#   2. it plays PATHFINDER_PGO_CORPUS once, profile data is written to pgo/<march>/data
+#   3. Volga-IT-Pathfinder-Optimized-<march> (the solver) and Volga-IT-Pathfinder-Bench-Optimized-<march> (the bench
+#      for measuring it) are built with the profile, LTO and -march=<march>
+# The pgo target builds all variants, so the fastest one is chosen by the bench of every variant.
+
+set(PATHFINDER_PGO_MARCH "native" CACHE STRING "Values of -march for optimized variants separated by semicolons")
+set(PATHFINDER_PGO_CORPUS "${CMAKE_CURRENT_SOURCE_DIR}/bench/corpus.txt" CACHE FILEPATH "Training corpus")
+
+if (CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+    # Profile files are named by object paths relative to -fprofile-prefix-path which was added in GCC 11
+    if (CMAKE_CXX_COMPILER_VERSION VERSION_LESS 11)
+        message(FATAL_ERROR "PATHFINDER_PGO needs GCC 11 or newer")
+    endif()
+elseif (CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+    find_program(PATHFINDER_LLVM_PROFDATA NAMES llvm-profdata)
+    if (NOT PATHFINDER_LLVM_PROFDATA)
+        message(FATAL_ERROR "PATHFINDER_PGO needs llvm-profdata for Clang")
+    endif()
+else()
+    message(FATAL_ERROR "PATHFINDER_PGO supports only GCC and Clang")
+endif()
+
+include(CheckIPOSupported)
+check_ipo_supported(RESULT PATHFINDER_IPO OUTPUT PATHFINDER_IPO_ERROR)
+if (NOT PATHFINDER_IPO)
+    message(WARNING "Optimized variants are built without LTO: ${PATHFINDER_IPO_ERROR}")
+endif()
+
+# Objects of the changed corpus must be built again, so the corpus is a part of their flags
+set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS "${PATHFINDER_PGO_CORPUS}")
+file(MD5 "${PATHFINDER_PGO_CORPUS}" PATHFINDER_PGO_CORPUS_HASH)
+
+add_custom_target(pgo)
+
+# Sets profile flags of the target. The instrumented target also links with them for the profile runtime. GCC looks
+# for profile files by object paths, so paths are taken relative to the object directory of the target and
+# the training objects match the optimized ones
+function(pathfinder_profile_flags target mode data)
+    if (CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+        target_compile_options(${target} PRIVATE "-fprofile-prefix-path=${CMAKE_CURRENT_BINARY_DIR}/CMakeFiles/${target}.dir")
+        if (mode STREQUAL "generate")
+            target_compile_options(${target} PRIVATE "-fprofile-generate=${data}" -fprofile-update=atomic)
+            set_property(TARGET ${target} APPEND_STRING PROPERTY LINK_FLAGS " -fprofile-generate=${data}")
+        else()
+            # Code which the corpus never runs is optimized as usual instead of for size
+            target_compile_options(${target} PRIVATE "-fprofile-use=${data}" -fprofile-partial-training -Wno-missing-profile)
+        endif()
+    else()
+        if (mode STREQUAL "generate")
+            target_compile_options(${target} PRIVATE "-fprofile-instr-generate=${data}/default.profraw")
+            set_property(TARGET ${target} APPEND_STRING PROPERTY LINK_FLAGS " -fprofile-instr-generate=${data}/default.profraw")
+        else()
+            target_compile_options(${target} PRIVATE
+                "-fprofile-instr-use=${data}/default.profdata"
+                -Wno-profile-instr-unprofiled
+                -Wno-profile-instr-out-of-date)
+        endif()
+    endif()
+endfunction()
+
+foreach (march IN LISTS PATHFINDER_PGO_MARCH)
+    set(data "${CMAKE_CURRENT_BINARY_DIR}/pgo/${march}/data")
+    set(stamp "${CMAKE_CURRENT_BINARY_DIR}/pgo/${march}/trained.stamp")
+    set(flags -O3 -march=${march} -DNDEBUG)
+
+    # Step 1: instrumented bench
+    set(training Volga-IT-Pathfinder-Training-${march})
+    add_executable(${training} src/bench.cpp ${PATHFINDER_CORE_SOURCES})
+    target_compile_options(${training} PRIVATE ${flags})
+    target_link_libraries(${training} PRIVATE Threads::Threads)
+    pathfinder_profile_flags(${training} generate "${data}")
+
+    # Step 2: old counters are removed, so the profile always belongs to the current sources
+    set(merge)
+    if (NOT CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+        set(merge COMMAND "${PATHFINDER_LLVM_PROFDATA}" merge "-output=${data}/default.profdata" "${data}/default.profraw")
+    endif()
+    add_custom_command(
+        OUTPUT "${stamp}"
+        COMMAND "${CMAKE_COMMAND}" -E remove_directory "${data}"
+        COMMAND "${CMAKE_COMMAND}" -E make_directory "${data}"
+        COMMAND ${training} --runs 1 --write "${CMAKE_CURRENT_BINARY_DIR}/pgo/${march}/training.json" "${PATHFINDER_PGO_CORPUS}"
+        ${merge}
+        COMMAND "${CMAKE_COMMAND}" -E touch "${stamp}"
+        DEPENDS ${training} "${PATHFINDER_PGO_CORPUS}"
+        COMMENT "Training the ${march} variant on ${PATHFINDER_PGO_CORPUS}"
+        VERBATIM
+    )
+    add_custom_target(${training}-Run DEPENDS "${stamp}")
+
+    # Step 3: objects are shared by the optimized solver and its bench. Only the solver is built with the profile,
+    # entry points of executables are not worth it
+    set(objects Volga-IT-Pathfinder-Optimized-Core-${march})
+    add_library(${objects} OBJECT ${PATHFINDER_CORE_SOURCES})
+    target_compile_options(${objects} PRIVATE ${flags})
+    target_compile_definitions(${objects} PRIVATE PATHFINDER_PGO_CORPUS_HASH=${PATHFINDER_PGO_CORPUS_HASH})
+    pathfinder_profile_flags(${objects} use "${data}")
+    add_dependencies(${objects} ${training}-Run)
+
+    foreach (variant IN ITEMS Volga-IT-Pathfinder-Optimized-${march} Volga-IT-Pathfinder-Bench-Optimized-${march})
+        if (variant MATCHES "Bench")
+            add_executable(${variant} src/bench.cpp $<TARGET_OBJECTS:${objects}>)
+        else()
+            add_executable(${variant} src/main.cpp $<TARGET_OBJECTS:${objects}>)
+        endif()
+        target_compile_options(${variant} PRIVATE ${flags})
+        target_link_libraries(${variant} PRIVATE Threads::Threads)
+        add_dependencies(pgo ${variant})
+    endforeach()
+
+    if (PATHFINDER_IPO)
+        set_property(TARGET ${objects} Volga-IT-Pathfinder-Optimized-${march} Volga-IT-Pathfinder-Bench-Optimized-${march}
+            PROPERTY INTERPROCEDURAL_OPTIMIZATION TRUE)
+    endif()
+endforeach()
@@ -0,0 +1,326 @@
+#include "fairy_tail.hpp"
+#include "game.hpp"
+#include "lockstep.hpp"
+#include "memory.hpp"
+#include "oracle.hpp"
+#include "pipeline.hpp"
+#include "stats.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Reads all labyrinths of the corpus. Labyrinths in the corpus are separated by empty lines
+///
+/// @param path Path to the corpus file
+///
+/// @returns Worlds of every labyrinth in the same order
+std::vector<std::shared_ptr<Fairyland>> read_corpus(const char* path)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error(std::string("Corpus not found: ") + path);
+    }
+
+    std::vector<std::shared_ptr<Fairyland>> worlds;
+    while ((file >> std::ws).peek() != std::char_traits<char>::eof()) {
+        worlds.push_back(std::make_shared<Fairyland>(file));
+    }
+    return worlds;
+}
+
+/// Plays worlds using lanes with the indicated lanes count
+std::vector<game::Result> simulate(const std::vector<std::shared_ptr<Fairyland>>& worlds, const int lanes)
+{
+    switch (lanes) {
+        case 8:
+            return lockstep::simulate<8>(worlds);
+        case 16:
+            return lockstep::simulate<16>(worlds);
+        default:
+            return lockstep::simulate<32>(worlds);
+    }
+}
+
+/// Reports how many games were finished early by the bounds check and, when they were measured, how many turns
+/// it saved
+void report_early(const size_t early, const long long saved_turns, const bool measured)
+{
+    std::cerr << "Early cannot-meet: " << early << " labyrinths";
+    if (measured) {
+        std::cerr << ", " << saved_turns << " turns saved";
+    }
+    std::cerr << std::endl;
+}
+
+/// Plays the corpus using pipeline::run and reports utilization of every stage. When statistics are recorded,
+/// distributions of every class of labyrinths are reported too
+int run_pipeline(const char* path, pipeline::Options options, const bool statistics)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error(std::string("Corpus not found: ") + path);
+    }
+
+    // Results are formatted by the only writer thread, so counters need no lock
+    size_t early = 0;
+    long long saved_turns = 0;
+    size_t budgeted = 0;
+    std::uint64_t budget_hits = 0;
+    const auto format = [&early, &saved_turns, &budgeted, &budget_hits](
+        std::string& buffer, const size_t index, const game::Result& result) {
+        buffer.append(std::to_string(index)).push_back(' ');
+        buffer.append(game::getVerdictName(result.verdict)).push_back(' ');
+        buffer.append(std::to_string(result.turn_count)).push_back('\n');
+        if (result.early) {
+            early += 1;
+            saved_turns += result.saved_turns;
+        }
+        if (result.budget_hits > 0) {
+            budgeted += 1;
+            budget_hits += result.budget_hits;
+        }
+    };
+
+    std::unique_ptr<stats::Statistics> recorders;
+    if (statistics) {
+        recorders.reset(new stats::Statistics(options.solvers));
+        options.statistics = recorders.get();
+    }
+
+    size_t count = 0;
+    const auto begin = std::chrono::steady_clock::now();
+    const auto stages = pipeline::run(file, std::cout, options, format, count);
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::cerr << count << " labyrinths in " << elapsed * 1000 << " ms ("
+        << (elapsed > 0 ? count * 60 / elapsed : 0) << " labyrinths per minute)" << std::endl;
+    for (const auto& stage : stages) {
+        // Utilization is the part of the wall time which threads of the stage spent on their own work
+        const auto total = elapsed * stage.threads;
+        std::cerr << "Stage " << stage.name << " (" << stage.threads << " threads): busy "
+            << (total > 0 ? stage.busy * 100 / total : 0) << "%, waiting "
+            << (total > 0 ? stage.waiting * 100 / total : 0) << "%" << std::endl;
+    }
+    report_early(early, saved_turns, options.measure);
+    if (options.budget.isLimited()) {
+        std::cerr << "Budget hit: " << budget_hits << " searches in " << budgeted << " labyrinths" << std::endl;
+    }
+    if (recorders) {
+        stats::report(std::cerr, *recorders->merge());
+    }
+    return 0;
+}
+
+/// Plays the first labyrinth of the corpus for Elena at every passage while Ivan stays at his start. The maze is
+/// loaded once and shared by worlds of all workers
+int run_sweep(const char* path, const size_t workers)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error(std::string("Corpus not found: ") + path);
+    }
+    const auto maze = std::make_shared<const Maze>(file);
+    const auto ivan = maze->getStarts()[0];
+
+    std::vector<std::pair<int, int>> starts;
+    for (int y = 0; y < static_cast<int>(maze->getHeight()); ++y) {
+        for (int x = 0; x < static_cast<int>(maze->getWidth()); ++x) {
+            if (maze->isPassage(x, y) && std::make_pair(x, y) != ivan) {
+                starts.emplace_back(x, y);
+            }
+        }
+    }
+
+    auto results = std::vector<game::Result>(
+        starts.size(),
+        game::Result(game::Verdict::AlgorithmError, 0, std::string()));
+    std::atomic<size_t> next(0);
+    const auto work = [&]() {
+        memory::Arena arena;
+        for (auto index = next.fetch_add(1); index < starts.size(); index = next.fetch_add(1)) {
+            const auto world = std::make_shared<Fairyland>(maze, ivan, starts[index]);
+            results[index] = game::play(world, arena);
+        }
+    };
+
+    const auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t index = 0; index < workers; ++index) {
+        threads.emplace_back(work);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    for (size_t index = 0; index < results.size(); ++index) {
+        std::cout << index << ' ' << starts[index].first << ' ' << starts[index].second << ' '
+            << game::getVerdictName(results[index].verdict) << ' ' << results[index].turn_count << '\n';
+    }
+    std::cerr << results.size() << " start positions in " << elapsed * 1000 << " ms" << std::endl;
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    // Usage: Volga-IT-Pathfinder-Batch [--lanes 8|16|32] [--verify] [--oracle] [--workers N] [--loaders N] [--sweep]
+    //     [--saved] [--stats] [--budget-expansions N] [--budget-us N] [--tiered] corpus.txt
+    int lanes = 0;
+    bool sweep = false;
+    bool statistics = false;
+    bool verify = false;
+    bool use_oracle = false;
+    const char* corpus = nullptr;
+    auto options = pipeline::Options();
+    options.solvers = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+    for (int index = 1; index < argc; ++index) {
+        if (strcmp("--lanes", argv[index]) == 0 && index + 1 < argc) {
+            lanes = std::atoi(argv[++index]);
+        }
+        else if (strcmp("--verify", argv[index]) == 0) {
+            verify = true;
+        }
+        else if (strcmp("--oracle", argv[index]) == 0) {
+            use_oracle = true;
+        }
+        else if (strcmp("--workers", argv[index]) == 0 && index + 1 < argc) {
+            options.solvers = static_cast<size_t>(std::atoi(argv[++index]));
+        }
+        else if (strcmp("--loaders", argv[index]) == 0 && index + 1 < argc) {
+            options.loaders = static_cast<size_t>(std::atoi(argv[++index]));
+        }
+        else if (strcmp("--sweep", argv[index]) == 0) {
+            sweep = true;
+        }
+        else if (strcmp("--saved", argv[index]) == 0) {
+            options.measure = true;
+        }
+        else if (strcmp("--stats", argv[index]) == 0) {
+            statistics = true;
+        }
+        else if (strcmp("--budget-expansions", argv[index]) == 0 && index + 1 < argc) {
+            options.budget.expansions = std::strtoull(argv[++index], nullptr, 10);
+        }
+        else if (strcmp("--budget-us", argv[index]) == 0 && index + 1 < argc) {
+            options.budget.microseconds = std::strtoull(argv[++index], nullptr, 10);
+        }
+        else if (strcmp("--tiered", argv[index]) == 0) {
+            options.tiered = true;
+        }
+        else {
+            corpus = argv[index];
+        }
+    }
+    if (corpus == nullptr
+        || (lanes != 0 && lanes != 8 && lanes != 16 && lanes != 32)
+        || options.solvers == 0
+        || options.loaders == 0
+        || ((statistics || options.budget.isLimited() || options.tiered) && (lanes != 0 || use_oracle || sweep))) {
+        std::cerr << "Usage: " << argv[0]
+            << " [--lanes 8|16|32] [--verify] [--oracle] [--workers N] [--loaders N] [--sweep] [--saved] [--stats]"
+            << " [--budget-expansions N] [--budget-us N] [--tiered] corpus.txt" << std::endl;
+        return 1;
+    }
+
+    if (sweep) {
+        return run_sweep(corpus, options.solvers);
+    }
+
+    // Labyrinths are played one by one while the next ones are loaded and previous results are written
+    if (lanes == 0 && !use_oracle) {
+        return run_pipeline(corpus, options, statistics);
+    }
+
+    const auto worlds = read_corpus(corpus);
+
+    // Oracle needs start positions, so it must be used before worlds are played
+    std::vector<oracle::Report> reports;
+    if (use_oracle) {
+        reports.reserve(worlds.size());
+        for (const auto& world : worlds) {
+            reports.push_back(oracle::solve(*world));
+        }
+    }
+
+    const auto begin = std::chrono::steady_clock::now();
+    std::vector<game::Result> results;
+    if (lanes != 0) {
+        results = simulate(worlds, lanes);
+    }
+    else {
+        // One arena serves all labyrinths, so warm runs do not touch the global heap
+        memory::Arena arena;
+        for (const auto& world : worlds) {
+            results.push_back(options.measure ? game::measure(world, arena) : game::play(world, arena));
+        }
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    size_t early = 0;
+    long long saved_turns = 0;
+    size_t wrong_verdicts = 0;
+    size_t met = 0;
+    double ratio_sum = 0;
+    double ratio_max = 0;
+    for (size_t index = 0; index < results.size(); ++index) {
+        const auto& result = results[index];
+        if (result.early) {
+            early += 1;
+            saved_turns += result.saved_turns;
+        }
+        std::cout << index << ' ' << game::getVerdictName(result.verdict) << ' ' << result.turn_count;
+        if (use_oracle) {
+            // Competitive ratio compares turn count with the shortest meeting time of pals who know the map
+            const auto& report = reports[index];
+            std::cout << ' ' << report.meeting_time;
+            if (result.verdict == game::Verdict::Met && report.meeting_time > 0) {
+                const auto ratio = static_cast<double>(result.turn_count) / report.meeting_time;
+                std::cout << ' ' << ratio;
+                met += 1;
+                ratio_sum += ratio;
+                ratio_max = ratio > ratio_max ? ratio : ratio_max;
+            }
+            if ((result.verdict == game::Verdict::Met) != report.can_meet) {
+                std::cout << " wrong";
+                wrong_verdicts += 1;
+            }
+        }
+        std::cout << '\n';
+    }
+    std::cerr << results.size() << " labyrinths in " << elapsed * 1000 << " ms ("
+        << (elapsed > 0 ? results.size() * 60 / elapsed : 0) << " labyrinths per minute)" << std::endl;
+    report_early(early, saved_turns, options.measure && lanes == 0);
+    if (use_oracle) {
+        std::cerr << "Competitive ratio: mean " << (met > 0 ? ratio_sum / met : 0) << ", max " << ratio_max << std::endl;
+        std::cerr << wrong_verdicts << " wrong verdicts" << std::endl;
+    }
+
+    // Lanes must give exactly the same results as the common game does
+    if (verify && lanes != 0) {
+        const auto scalar_worlds = read_corpus(corpus);
+        size_t mismatches = 0;
+        for (size_t index = 0; index < scalar_worlds.size(); ++index) {
+            const auto expected = game::play(scalar_worlds[index]);
+            const auto& actual = results[index];
+            if (expected.verdict != actual.verdict
+                || expected.turn_count != actual.turn_count
+                || expected.message != actual.message
+                || expected.map != actual.map) {
+                std::cerr << "Mismatch at labyrinth " << index << std::endl;
+                mismatches += 1;
+            }
+        }
+        std::cerr << mismatches << " mismatches" << std::endl;
+        return mismatches == 0 ? 0 : 1;
+    }
+    return 0;
+}
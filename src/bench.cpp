@@ -0,0 +1,425 @@
+#include "fairy_tail.hpp"
+#include "game.hpp"
+#include "pipeline.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    /// Allocations of the global heap since the start of the program
+    std::atomic<std::uint64_t> gAllocations(0);
+    /// Bytes of the global heap which are allocated right now
+    std::atomic<long long> gLiveBytes(0);
+    /// The highest value of gLiveBytes since the last reset
+    std::atomic<long long> gPeakBytes(0);
+
+    /// Every block keeps its size in front of the memory given to the caller
+    const size_t gHeaderSize = sizeof(std::max_align_t);
+
+    void* allocateCounted(const size_t size)
+    {
+        if (size > static_cast<size_t>(std::numeric_limits<std::ptrdiff_t>::max()) - gHeaderSize) {
+            throw std::bad_alloc();
+        }
+        auto block = static_cast<char*>(std::malloc(size + gHeaderSize));
+        if (block == nullptr) {
+            throw std::bad_alloc();
+        }
+        *reinterpret_cast<size_t*>(block) = size;
+
+        gAllocations.fetch_add(1);
+        const auto live = gLiveBytes.fetch_add(static_cast<long long>(size)) + static_cast<long long>(size);
+        auto peak = gPeakBytes.load();
+        while (live > peak && !gPeakBytes.compare_exchange_weak(peak, live)) {}
+        return block + gHeaderSize;
+    }
+
+    void releaseCounted(void* pointer) noexcept
+    {
+        if (pointer == nullptr) {
+            return;
+        }
+        const auto block = static_cast<char*>(pointer) - gHeaderSize;
+        gLiveBytes.fetch_sub(static_cast<long long>(*reinterpret_cast<size_t*>(block)));
+        std::free(block);
+    }
+}
+
+// The bench counts every allocation of the solver, so the global heap is replaced only in this executable
+
+void* operator new(size_t size)
+{
+    return allocateCounted(size);
+}
+
+void* operator new[](size_t size)
+{
+    return allocateCounted(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    releaseCounted(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    releaseCounted(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    releaseCounted(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+    releaseCounted(pointer);
+}
+
+/// Represents measures of one labyrinth. Everything except time is the same in every run
+struct Record {
+    size_t index;
+    std::string hash;           //!< Hash of the labyrinth text, so the baseline of another corpus is never compared
+    std::string verdict;
+    long long turns;
+    long long expansions;       //!< Nodes expanded by searches of both pals (see game::Result::expansions)
+    long long allocations;      //!< Allocations of the global heap
+    long long peak_bytes;       //!< The highest amount of heap bytes used at once above the level before the game
+    double time_median_us;      //!< Median wall time of runs
+    double time_mad_us;         //!< Median absolute deviation of wall time of runs
+
+    Record() noexcept
+        : index(0), turns(0), expansions(0), allocations(0), peak_bytes(0), time_median_us(0), time_mad_us(0)
+    {}
+};
+
+/// Represents thresholds of the comparison with the baseline
+struct Thresholds {
+    double mad;        //!< Time is noise while it is within this amount of scaled MADs
+    double tolerance;  //!< Time is noise while it is within this part of the baseline median
+    double floor_us;   //!< Time is noise while it is within this amount of microseconds
+
+    Thresholds() noexcept : mad(3), tolerance(0.25), floor_us(5) {}
+};
+
+/// @returns FNV-1a hash of the text as 16 hex digits
+std::string hash_text(const std::string& text)
+{
+    std::uint64_t hash = 0xCBF29CE484222325ULL;
+    for (const auto symbol : text) {
+        hash ^= static_cast<unsigned char>(symbol);
+        hash *= 0x100000001B3ULL;
+    }
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+    return buffer;
+}
+
+/// @returns Median of values. Values are reordered
+double median(std::vector<double>& values)
+{
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    const auto middle = values.size() / 2;
+    return values.size() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+}
+
+/// Plays every labyrinth the same way as the main executable does: the world is parsed from the text and played
+/// by game::play with its own arena. Runs go over the whole corpus, so slow drift of the machine is shared by all
+/// labyrinths
+std::vector<Record> measure(const std::vector<std::string>& labyrinths, const size_t runs)
+{
+    std::vector<Record> records(labyrinths.size());
+    std::vector<std::vector<double>> times(labyrinths.size());
+    for (size_t run = 0; run < runs; ++run) {
+        for (size_t index = 0; index < labyrinths.size(); ++index) {
+            const auto allocations = gAllocations.load();
+            const auto live = gLiveBytes.load();
+            gPeakBytes.store(live);
+
+            const auto begin = std::chrono::steady_clock::now();
+            std::istringstream input(labyrinths[index]);
+            const auto world = std::make_shared<Fairyland>(input);
+            const auto result = game::play(world);
+            const auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin);
+            times[index].push_back(elapsed.count());
+
+            auto& record = records[index];
+            record.index = index;
+            record.hash = hash_text(labyrinths[index]);
+            record.verdict = game::getVerdictName(result.verdict);
+            record.turns = result.turn_count;
+            record.expansions = static_cast<long long>(result.expansions);
+            record.allocations = static_cast<long long>(gAllocations.load() - allocations);
+            record.peak_bytes = gPeakBytes.load() - live;
+        }
+    }
+
+    for (size_t index = 0; index < records.size(); ++index) {
+        auto& record = records[index];
+        record.time_median_us = median(times[index]);
+        std::vector<double> deviations;
+        for (const auto time : times[index]) {
+            deviations.push_back(std::fabs(time - record.time_median_us));
+        }
+        record.time_mad_us = median(deviations);
+    }
+    return records;
+}
+
+/// Writes records as the baseline JSON
+void write_baseline(std::ostream& output, const std::vector<Record>& records, const size_t runs)
+{
+    output << "{\n  \"runs\": " << runs << ",\n  \"labyrinths\": [\n";
+    for (size_t index = 0; index < records.size(); ++index) {
+        const auto& record = records[index];
+        char times[64];
+        std::snprintf(times, sizeof(times), "%.3f, \"time_mad_us\": %.3f", record.time_median_us, record.time_mad_us);
+        output << "    { \"index\": " << record.index
+            << ", \"hash\": \"" << record.hash << "\""
+            << ", \"verdict\": \"" << record.verdict << "\""
+            << ", \"turns\": " << record.turns
+            << ", \"expansions\": " << record.expansions
+            << ", \"allocations\": " << record.allocations
+            << ", \"peak_bytes\": " << record.peak_bytes
+            << ", \"time_median_us\": " << times << " }"
+            << (index + 1 < records.size() ? ",\n" : "\n");
+    }
+    output << "  ]\n}\n";
+}
+
+/// Reads the baseline written by write_baseline. Only flat objects of the "labyrinths" array are read, every
+/// value is a number or a string without escapes
+///
+/// @throws std::runtime_error when the baseline is malformed
+std::vector<Record> read_baseline(std::istream& input)
+{
+    const auto text = std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    auto position = text.find("\"labyrinths\"");
+    if (position == std::string::npos) {
+        throw std::runtime_error("Baseline has no labyrinths");
+    }
+
+    std::vector<Record> records;
+    while ((position = text.find('{', position)) != std::string::npos) {
+        const auto end = text.find('}', position);
+        if (end == std::string::npos) {
+            throw std::runtime_error("Baseline object is not closed");
+        }
+
+        // Object is parsed as "key": value pairs separated by commas
+        std::map<std::string, std::string> fields;
+        std::istringstream object(text.substr(position + 1, end - position - 1));
+        std::string pair;
+        while (std::getline(object, pair, ',')) {
+            const auto colon = pair.find(':');
+            const auto key_begin = pair.find('"');
+            const auto key_end = key_begin == std::string::npos ? key_begin : pair.find('"', key_begin + 1);
+            if (colon == std::string::npos || key_end == std::string::npos || key_end > colon) {
+                throw std::runtime_error("Baseline field is malformed: " + pair);
+            }
+            auto value = pair.substr(colon + 1);
+            value.erase(0, value.find_first_not_of(" \t\r\n\""));
+            value.erase(value.find_last_not_of(" \t\r\n\"") + 1);
+            fields[pair.substr(key_begin + 1, key_end - key_begin - 1)] = value;
+        }
+
+        const auto field = [&fields](const char* key) -> const std::string& {
+            const auto found = fields.find(key);
+            if (found == fields.end()) {
+                throw std::runtime_error(std::string("Baseline field is missing: ") + key);
+            }
+            return found->second;
+        };
+        Record record;
+        record.index = static_cast<size_t>(std::atoll(field("index").c_str()));
+        record.hash = field("hash");
+        record.verdict = field("verdict");
+        record.turns = std::atoll(field("turns").c_str());
+        record.expansions = std::atoll(field("expansions").c_str());
+        record.allocations = std::atoll(field("allocations").c_str());
+        record.peak_bytes = std::atoll(field("peak_bytes").c_str());
+        record.time_median_us = std::atof(field("time_median_us").c_str());
+        record.time_mad_us = std::atof(field("time_mad_us").c_str());
+        records.push_back(record);
+        position = end + 1;
+    }
+    return records;
+}
+
+/// Writes one line of the diff report
+///
+/// @returns 1 when the change is a regression otherwise 0
+size_t report_change(
+    const size_t index,
+    const char* metric,
+    const double before,
+    const double after,
+    const bool regression,
+    const std::string& note)
+{
+    std::cout << '#' << index << ' ' << metric << ' ' << before << " -> " << after;
+    if (before != 0) {
+        std::cout << " (" << (after > before ? "+" : "") << (after - before) * 100 / before << "%" << note << ")";
+    }
+    std::cout << (regression ? " regression" : " improvement") << '\n';
+    return regression ? 1 : 0;
+}
+
+/// Writes the per-labyrinth diff report. Counters are the same in every run, so any change of them is reported.
+/// Time is reported only when the change is out of noise of both runs
+///
+/// @returns Amount of regressions
+size_t compare(const std::vector<Record>& baseline, const std::vector<Record>& records, const Thresholds& thresholds)
+{
+    if (baseline.size() != records.size()) {
+        throw std::runtime_error(
+            "Baseline has " + std::to_string(baseline.size()) + " labyrinths but the corpus has "
+            + std::to_string(records.size()));
+    }
+
+    size_t regressions = 0;
+    size_t improvements = 0;
+    for (size_t index = 0; index < records.size(); ++index) {
+        const auto& before = baseline[index];
+        const auto& after = records[index];
+        if (before.hash != after.hash) {
+            throw std::runtime_error("Labyrinth " + std::to_string(index) + " differs from the baseline one");
+        }
+        if (before.verdict != after.verdict) {
+            std::cout << '#' << index << " verdict " << before.verdict << " -> " << after.verdict << " regression\n";
+            regressions += 1;
+        }
+
+        const struct {
+            const char* name;
+            long long before;
+            long long after;
+        } counters[] = {
+            { "turns", before.turns, after.turns },
+            { "expansions", before.expansions, after.expansions },
+            { "allocations", before.allocations, after.allocations },
+            { "peak_bytes", before.peak_bytes, after.peak_bytes },
+        };
+        for (const auto& counter : counters) {
+            if (counter.before != counter.after) {
+                const auto regression = counter.after > counter.before;
+                regressions += report_change(
+                    index,
+                    counter.name,
+                    static_cast<double>(counter.before),
+                    static_cast<double>(counter.after),
+                    regression,
+                    std::string());
+                improvements += regression ? 0 : 1;
+            }
+        }
+
+        // 1.4826 scales MAD to the standard deviation of the normal distribution
+        const auto mad = before.time_mad_us > after.time_mad_us ? before.time_mad_us : after.time_mad_us;
+        const auto noise = std::max(
+            std::max(thresholds.mad * 1.4826 * mad, thresholds.tolerance * before.time_median_us),
+            thresholds.floor_us);
+        if (std::fabs(after.time_median_us - before.time_median_us) > noise) {
+            const auto regression = after.time_median_us > before.time_median_us;
+            std::ostringstream note;
+            note << ", noise " << noise << " us";
+            regressions += report_change(
+                index, "time_us", before.time_median_us, after.time_median_us, regression, note.str());
+            improvements += regression ? 0 : 1;
+        }
+    }
+    std::cout << records.size() << " labyrinths: " << regressions << " regressions, " << improvements
+        << " improvements" << std::endl;
+    return regressions;
+}
+
+int main(int argc, char** argv)
+{
+    // Usage: Volga-IT-Pathfinder-Bench [--runs N] [--baseline baseline.json] [--write baseline.json] [--mad K]
+    //     [--tolerance R] [--floor US] corpus.txt
+    size_t runs = 7;
+    const char* baseline_path = nullptr;
+    const char* write_path = nullptr;
+    const char* corpus = nullptr;
+    Thresholds thresholds;
+    for (int index = 1; index < argc; ++index) {
+        if (strcmp("--runs", argv[index]) == 0 && index + 1 < argc) {
+            runs = static_cast<size_t>(std::atoi(argv[++index]));
+        }
+        else if (strcmp("--baseline", argv[index]) == 0 && index + 1 < argc) {
+            baseline_path = argv[++index];
+        }
+        else if (strcmp("--write", argv[index]) == 0 && index + 1 < argc) {
+            write_path = argv[++index];
+        }
+        else if (strcmp("--mad", argv[index]) == 0 && index + 1 < argc) {
+            thresholds.mad = std::atof(argv[++index]);
+        }
+        else if (strcmp("--tolerance", argv[index]) == 0 && index + 1 < argc) {
+            thresholds.tolerance = std::atof(argv[++index]);
+        }
+        else if (strcmp("--floor", argv[index]) == 0 && index + 1 < argc) {
+            thresholds.floor_us = std::atof(argv[++index]);
+        }
+        else {
+            corpus = argv[index];
+        }
+    }
+    if (corpus == nullptr || runs == 0 || (baseline_path == nullptr && write_path == nullptr)) {
+        std::cerr << "Usage: " << argv[0]
+            << " [--runs N] [--baseline baseline.json] [--write baseline.json] [--mad K] [--tolerance R]"
+            << " [--floor US] corpus.txt" << std::endl;
+        return 1;
+    }
+
+    std::ifstream file(corpus);
+    if (!file.is_open()) {
+        throw std::runtime_error(std::string("Corpus not found: ") + corpus);
+    }
+    std::vector<std::string> labyrinths;
+    std::string labyrinth;
+    while (pipeline::readLabyrinth(file, labyrinth)) {
+        labyrinths.push_back(labyrinth);
+    }
+
+    const auto records = measure(labyrinths, runs);
+    if (write_path != nullptr) {
+        std::ofstream output(write_path);
+        write_baseline(output, records, runs);
+        if (!output) {
+            throw std::runtime_error(std::string("Cannot write the baseline to ") + write_path);
+        }
+        std::cerr << "Baseline of " << records.size() << " labyrinths is written to " << write_path << std::endl;
+    }
+    if (baseline_path == nullptr) {
+        return 0;
+    }
+
+    std::ifstream baseline_file(baseline_path);
+    if (!baseline_file.is_open()) {
+        throw std::runtime_error(std::string("Baseline not found: ") + baseline_path);
+    }
+    return compare(read_baseline(baseline_file), records, thresholds) == 0 ? 0 : 1;
+}
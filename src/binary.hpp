@@ -0,0 +1,30 @@
+#pragma once
+
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace binary {
+    /// Writes the value as is, so files are read only by the same build on the same machine
+    template <typename T>
+    void write(std::ostream& output, const T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivial values are written as is");
+        output.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    /// Reads the value written by binary::write
+    ///
+    /// @throws std::runtime_error when the stream ends before the value
+    template <typename T>
+    T read(std::istream& input)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivial values are read as is");
+        T value;
+        if (!input.read(reinterpret_cast<char*>(&value), sizeof(T))) {
+            throw std::runtime_error("Unexpected end of the binary data");
+        }
+        return value;
+    }
+}
@@ -0,0 +1,756 @@
+#pragma once
+
+#include "fairy_tail.hpp"
+#include "graph.hpp"
+#include "memory.hpp"
+#include "pathfinder.hpp"
+
+#include <bitset>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace bitboard {
+    template <int W, int H>
+    struct Masks;  // Predefinition
+
+    /// Represents a set of cells of the frame which can contain any graph of the labyrinth not larger than W x H.
+    /// The frame has (2W - 1) x (2H - 1) cells, so the start node lays at the center and any other node relative
+    /// to it stays inside. Every row has one extra padding cell which is never set, so horizontal shifts cannot
+    /// move bits between rows. Cell index is y * stride + x where y grows in graph::Direction::Up direction
+    template <int W, int H>
+    class Bitboard {
+        static_assert(W >= 3 && H >= 3, "Bitboard requires the labyrinth at least 3x3 size");
+
+    public:
+        static constexpr int width = 2 * W - 1;
+        static constexpr int height = 2 * H - 1;
+        static constexpr int stride = width + 1;
+        static constexpr int cells = stride * height;
+        static constexpr int words = (cells + 63) / 64;
+
+        constexpr Bitboard() noexcept : m_words{} {}
+
+    public:
+        /// @returns Index of the cell at (x; y) of the frame. Also converts frame offset into the index delta
+        static constexpr int index(const int x, const int y) noexcept
+        {
+            return y * stride + x;
+        }
+
+        /// @returns Board where all cells of the frame are set and padding cells are not
+        static constexpr Bitboard makeFrame() noexcept
+        {
+            Bitboard board;
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    board.set(index(x, y));
+                }
+            }
+            return board;
+        }
+
+        /// Sets the cell at the index
+        constexpr void set(const int index) noexcept
+        {
+            m_words[index / 64] |= std::uint64_t(1) << (index % 64);
+        }
+
+        /// @returns True if the cell at the index is set. Index may lay out of the frame
+        bool test(const int index) const noexcept
+        {
+            return index >= 0 && index < cells && ((m_words[index / 64] >> (index % 64)) & 1) != 0;
+        }
+
+        /// @returns True if any cell is set
+        bool any() const noexcept
+        {
+            for (const auto word : m_words) {
+                if (word != 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /// @returns Amount of set cells
+        size_t count() const noexcept
+        {
+            size_t count = 0;
+            for (const auto word : m_words) {
+                count += std::bitset<64>(word).count();
+            }
+            return count;
+        }
+
+        /// Calls function with index of every set cell in ascending order
+        template <typename Function>
+        void forEach(Function function) const
+        {
+            for (int word = 0; word < words; ++word) {
+                for (auto bits = m_words[word]; bits != 0; bits &= bits - 1) {
+                    function(word * 64 + static_cast<int>(std::bitset<64>((bits & (~bits + 1)) - 1).count()));
+                }
+            }
+        }
+
+        /// @returns The set of cells at the direction relative to cells of this set. Out of frame cells are lost
+        Bitboard at(const graph::Direction direction) const noexcept
+        {
+            switch (direction) {
+                case graph::Direction::Left:
+                    return shifted(-1);
+                case graph::Direction::Right:
+                    return shifted(1);
+                case graph::Direction::Up:
+                    return shifted(stride);
+                default:
+                    return shifted(-stride);
+            }
+        }
+
+        /// @returns The set of cells which are neighbors of cells of this set
+        Bitboard spread() const noexcept
+        {
+            return at(graph::Direction::Left)
+                | at(graph::Direction::Right)
+                | at(graph::Direction::Up)
+                | at(graph::Direction::Down);
+        }
+
+        /// Moves every cell by delta indices. Cells which are moved out of the frame or into padding are lost,
+        /// so the caller must guarantee that rows don't wrap when delta moves cells horizontally
+        Bitboard shifted(const int delta) const noexcept
+        {
+            Bitboard board;
+            const int word = (delta < 0 ? -delta : delta) / 64;
+            const int bit = (delta < 0 ? -delta : delta) % 64;
+            if (delta >= 0) {
+                for (int index = words - 1; index >= word; --index) {
+                    board.m_words[index] = m_words[index - word] << bit;
+                    if (bit != 0 && index - word > 0) {
+                        board.m_words[index] |= m_words[index - word - 1] >> (64 - bit);
+                    }
+                }
+            }
+            else {
+                for (int index = 0; index + word < words; ++index) {
+                    board.m_words[index] = m_words[index + word] >> bit;
+                    if (bit != 0 && index + word + 1 < words) {
+                        board.m_words[index] |= m_words[index + word + 1] << (64 - bit);
+                    }
+                }
+            }
+            return board & Masks<W, H>::frame;
+        }
+
+        /// @returns Cells of this set which are not in the other set
+        Bitboard without(const Bitboard& other) const noexcept
+        {
+            Bitboard board;
+            for (int index = 0; index < words; ++index) {
+                board.m_words[index] = m_words[index] & ~other.m_words[index];
+            }
+            return board;
+        }
+
+        Bitboard operator | (const Bitboard& other) const noexcept
+        {
+            Bitboard board;
+            for (int index = 0; index < words; ++index) {
+                board.m_words[index] = m_words[index] | other.m_words[index];
+            }
+            return board;
+        }
+
+        Bitboard operator & (const Bitboard& other) const noexcept
+        {
+            Bitboard board;
+            for (int index = 0; index < words; ++index) {
+                board.m_words[index] = m_words[index] & other.m_words[index];
+            }
+            return board;
+        }
+
+        Bitboard& operator |= (const Bitboard& other) noexcept
+        {
+            for (int index = 0; index < words; ++index) {
+                m_words[index] |= other.m_words[index];
+            }
+            return *this;
+        }
+
+    private:
+        std::uint64_t m_words[words];
+    };
+
+    /// Holds constant masks of the frame which are built at compile time
+    template <int W, int H>
+    struct Masks {
+        static constexpr Bitboard<W, H> frame = Bitboard<W, H>::makeFrame();
+    };
+
+    template <int W, int H>
+    constexpr Bitboard<W, H> Masks<W, H>::frame;
+
+    /// Represents the pathfinder of the labyrinth not larger than W x H which keeps known passages, visited and
+    /// deadend nodes as bitboards. Gives the same advices as graph::Graph with pathfinder::Pathfinder do, so it
+    /// can be used with game::Match instead of them
+    template <int W, int H>
+    class Pal {
+    public:
+        using Board = Bitboard<W, H>;
+
+        Pal() noexcept;
+
+    public:
+        /// @returns True if the labyrinth with such size fits the frame of this pal
+        static bool fits(const std::size_t width, const std::size_t height) noexcept;
+
+        /// Checks if the current node is a deadend. See graph::Node::deadendCheck
+        bool deadendCheck() noexcept;
+
+        /// Gives an advice. See pathfinder::Pathfinder::getAdvice
+        pathfinder::Advice getAdvice() noexcept;
+
+        /// @returns Amount of searches which were paused by the budget. Equals graph::Graph::getBudgetHits when
+        /// only expansions are limited
+        std::uint64_t getBudgetHits() const noexcept;
+
+        /// @returns Amount of nodes which were expanded by all searches. Equals graph::Graph::getExpansions
+        std::uint64_t getExpansions() const noexcept;
+
+        /// @returns Translation-invariant hash of known nodes. Equals graph::Graph::getFingerprint of the same nodes
+        std::uint64_t getFingerprint() const noexcept;
+
+        /// @returns Amount of known nodes
+        size_t getNodeCount() const noexcept;
+
+        /// @returns Rectangle of known nodes in the frame coordinates. Have O(1) complexity
+        graph::Rectangle getRectangle() const noexcept;
+
+        /// Same as graph::Graph::isAlignable. Boards of another pal are shifted, so every offset is checked
+        /// by a few word operations
+        bool isAlignable(const Pal& pal, const graph::Rectangle& deltas, graph::Position& delta) const noexcept;
+
+        /// Moves the pal in the indicated direction and updates node using open directions of the new cell
+        void go(const graph::Direction direction, const unsigned char mask) noexcept;
+
+        /// Checks if all nodes are visited
+        bool isExplored() const noexcept;
+
+        /// Resets deadend and visited nodes for rerunning the labyrinth. Bounds inference is disabled
+        void rerun() noexcept;
+
+        /// Restores the map the same way as graph::Graph::restoreMap does but without shifting of nodes
+        std::string restoreMap(
+            const Pal& pal,
+            const char this_start,
+            const char other_start,
+            const int width,
+            const int height) const noexcept;
+
+        /// Sets size of the labyrinth for the bounds inference. See graph::Graph::setBounds
+        void setBounds(const int width, const int height) noexcept;
+
+        /// Sets the limit of every search for unvisited nodes. See graph::Graph::setBudget
+        void setBudget(const graph::Budget& budget) noexcept;
+
+        /// Adds nodes at open directions of the current cell and prunes the frontier. Bit N of the mask is set for
+        /// the direction with N underlying value
+        void updateNode(const unsigned char mask) noexcept;
+
+    private:
+        /// @returns Cells of the frame in columns [min_x; max_x] and rows [min_y; max_y]. Bounds may lay out of
+        /// the frame
+        static Board getArea(const int min_x, const int min_y, const int max_x, const int max_y) noexcept;
+
+        /// @returns Index of the cell at the direction relative to the cell at the index
+        static int step(const int index, const graph::Direction direction) noexcept;
+
+        /// Same as graph::Node::deadendCheck for the node at the index
+        bool deadendCheck(const int index) noexcept;
+
+        /// Same as graph::Graph::findUnvisitedNode. The search returns the lexicographically smallest (left, right,
+        /// up, down) route among the shortest routes to unvisited nodes, so this one floods distance layers and
+        /// then walks back choosing the first direction which still leads to the target. The budget is checked
+        /// before every layer like graph::Graph::findUnvisitedNode does, so the paused search is kept by the frontier
+        graph::Route findUnvisitedNode() const noexcept;
+
+        /// Same as graph::Graph::pruneFrontier. Cells which may be inside of the labyrinth and are neither nodes
+        /// nor neighbors of visited nodes are unknown, and nodes without unknown neighbors are marked visited at once
+        void pruneFrontier() noexcept;
+
+    private:
+        Board m_passages;  //!< Known nodes
+        Board m_visited;   //!< Visited nodes
+        Board m_deadends;  //!< Nodes which had deadend check passed
+        graph::Fingerprint m_fingerprint;  //!< Fingerprint of known nodes in the frame coordinates
+        graph::Rectangle m_rectangle;      //!< Rectangle of known nodes in the frame coordinates
+        int m_current;
+        int m_start;
+        int m_width;   //!< Width of the labyrinth or 0 when it is unknown
+        int m_height;  //!< Height of the labyrinth or 0 when it is unknown
+        mutable std::uint64_t m_expansions;  //!< See Pal::getExpansions
+        graph::Budget m_budget;
+        mutable Board m_frontier;  //!< The layer of the paused search which is not expanded yet
+        mutable Board m_seen;      //!< Nodes which were reached by the paused search
+        mutable size_t m_distance;  //!< Distance of the paused search to its frontier
+        mutable bool m_paused;      //!< True when the last search was paused by the budget
+        mutable std::uint64_t m_budget_hits;  //!< See Pal::getBudgetHits
+    };
+
+    /* Pal */
+
+    template <int W, int H>
+    Pal<W, H>::Pal() noexcept
+        : m_rectangle(W - 1, H - 1, W - 1, H - 1),
+        m_current(Board::index(W - 1, H - 1)),
+        m_start(Board::index(W - 1, H - 1)),
+        m_width(0),
+        m_height(0),
+        m_expansions(0),
+        m_distance(0),
+        m_paused(false),
+        m_budget_hits(0)
+    {
+        m_passages.set(m_start);
+        m_visited.set(m_start);
+        m_fingerprint.add(graph::Position(W - 1, H - 1));
+    }
+
+    template <int W, int H>
+    bool Pal<W, H>::fits(const std::size_t width, const std::size_t height) noexcept
+    {
+        return width <= W && height <= H;
+    }
+
+    template <int W, int H>
+    bool Pal<W, H>::deadendCheck() noexcept
+    {
+        return deadendCheck(m_current);
+    }
+
+    template <int W, int H>
+    pathfinder::Advice Pal<W, H>::getAdvice() noexcept
+    {
+        const auto directions = {
+            graph::Direction::Left,
+            graph::Direction::Right,
+            graph::Direction::Up,
+            graph::Direction::Down
+        };
+
+        // DEADEND ADVICE
+        if (deadendCheck(m_current)) {
+            // Find only one no deadend
+            for (const auto& direction : directions) {
+                const auto index = step(m_current, direction);
+                if (m_passages.test(index) && !deadendCheck(index)) {
+                    return pathfinder::Advice(pathfinder::AdviceType::Move, { direction });
+                }
+            }
+        }
+
+        // VISIT UNVISITED ADVICE
+        if (!isExplored()) {
+            auto route = findUnvisitedNode();
+            if (!route.empty()) {
+                return pathfinder::Advice(pathfinder::AdviceType::Move, std::move(route));
+            }
+            if (m_paused) {
+                return pathfinder::Advice(pathfinder::AdviceType::Wait);
+            }
+        }
+
+        return pathfinder::Advice(pathfinder::AdviceType::Rendezvous);
+    }
+
+    template <int W, int H>
+    std::uint64_t Pal<W, H>::getBudgetHits() const noexcept
+    {
+        return m_budget_hits;
+    }
+
+    template <int W, int H>
+    std::uint64_t Pal<W, H>::getExpansions() const noexcept
+    {
+        return m_expansions;
+    }
+
+    template <int W, int H>
+    std::uint64_t Pal<W, H>::getFingerprint() const noexcept
+    {
+        return m_fingerprint.get(getRectangle());
+    }
+
+    template <int W, int H>
+    size_t Pal<W, H>::getNodeCount() const noexcept
+    {
+        return m_passages.count();
+    }
+
+    template <int W, int H>
+    void Pal<W, H>::go(const graph::Direction direction, const unsigned char mask) noexcept
+    {
+        m_current = step(m_current, direction);
+        m_visited.set(m_current);
+        updateNode(mask);
+        deadendCheck(m_current);
+    }
+
+    template <int W, int H>
+    bool Pal<W, H>::isAlignable(const Pal& pal, const graph::Rectangle& deltas, graph::Position& delta) const noexcept
+    {
+        const auto this_rect = getRectangle();
+        const auto other_rect = pal.getRectangle();
+        const auto this_walls = m_visited.spread().without(m_passages);
+
+        for (int delta_y = deltas.min_y; delta_y <= deltas.max_y; ++delta_y) {
+            for (int delta_x = deltas.min_x; delta_x <= deltas.max_x; ++delta_x) {
+                // Both rectangles stay in the labyrinth, so shifted nodes never leave the frame
+                const auto shift = Board::index(
+                    this_rect.min_x + delta_x - other_rect.min_x,
+                    this_rect.min_y + delta_y - other_rect.min_y);
+                if (pal.m_current + shift == m_current) {
+                    continue;
+                }
+
+                const auto other_passages = pal.m_passages.shifted(shift);
+                const auto other_walls = pal.m_visited.shifted(shift).spread().without(other_passages);
+                if (!(other_passages & this_walls).any() && !(m_passages & other_walls).any()) {
+                    delta = graph::Position(delta_x, delta_y);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    template <int W, int H>
+    bool Pal<W, H>::isExplored() const noexcept
+    {
+        return !m_passages.without(m_visited).any();
+    }
+
+    template <int W, int H>
+    void Pal<W, H>::rerun() noexcept
+    {
+        m_paused = false;
+        m_width = 0;
+        m_height = 0;
+        m_deadends = Board();
+        m_visited = Board();
+        m_visited.set(m_current);
+        deadendCheck(m_current);
+    }
+
+    template <int W, int H>
+    std::string Pal<W, H>::restoreMap(
+        const Pal& pal,
+        const char this_start,
+        const char other_start,
+        const int width,
+        const int height) const noexcept
+    {
+        // Positions are normalized relative to rectangles as graph::Graph::normalizeRect does
+        const auto this_rect = getRectangle();
+        const auto other_rect = pal.getRectangle();
+
+        const auto this_cn_spot = graph::Position(
+            m_current % Board::stride - this_rect.min_x,
+            m_current / Board::stride - this_rect.min_y);
+        const auto other_cn_spot = graph::Position(
+            pal.m_current % Board::stride - other_rect.min_x,
+            pal.m_current / Board::stride - other_rect.min_y);
+
+        // Possible spot for centering map
+        const auto cn_invariants = {
+            this_cn_spot,                                          // Center
+            graph::Position(this_cn_spot.x - 1, this_cn_spot.y),  // Left-center
+            graph::Position(this_cn_spot.x + 1, this_cn_spot.y),  // Right-center
+            graph::Position(this_cn_spot.x, this_cn_spot.y + 1),  // Up-center
+            graph::Position(this_cn_spot.x, this_cn_spot.y - 1)   // Down-center
+        };
+        for (const auto& cn_spot : cn_invariants) {
+            const auto delta_x = cn_spot.x - other_cn_spot.x;
+            const auto delta_y = cn_spot.y - other_cn_spot.y;
+
+            const auto this_delta_x = delta_x < 0 ? -delta_x : 0;
+            const auto this_delta_y = delta_y < 0 ? -delta_y : 0;
+            const auto other_delta_x = delta_x > 0 ? delta_x : 0;
+            const auto other_delta_y = delta_y > 0 ? delta_y : 0;
+
+            // These rects can be out of bounds, in that case connection spot is wrong
+            if (this_rect.max_x - this_rect.min_x + this_delta_x >= width ||
+                this_rect.max_y - this_rect.min_y + this_delta_y >= height ||
+                other_rect.max_x - other_rect.min_x + other_delta_x >= width ||
+                other_rect.max_y - other_rect.min_y + other_delta_y >= height) {
+                continue;
+            }
+
+            // Both boards are placed so that the map origin is at (1; 1) of the frame. That keeps walls
+            // of the labyrinth border inside the frame
+            const auto this_shift = Board::index(1 + this_delta_x - this_rect.min_x, 1 + this_delta_y - this_rect.min_y);
+            const auto other_shift = Board::index(1 + other_delta_x - other_rect.min_x, 1 + other_delta_y - other_rect.min_y);
+
+            const auto this_passages = m_passages.shifted(this_shift);
+            const auto other_passages = pal.m_passages.shifted(other_shift);
+            const auto passages = this_passages | other_passages;
+            const auto walls = m_visited.shifted(this_shift).spread().without(this_passages)
+                | pal.m_visited.shifted(other_shift).spread().without(other_passages);
+
+            if ((passages & walls).any()) {
+                continue;
+            }
+
+            std::string sheet;
+            sheet.reserve((width + 1) * height);
+            for (int y = height - 1; y > -1; --y) {
+                for (int x = 0; x < width; ++x) {
+                    const auto index = Board::index(x + 1, y + 1);
+                    sheet.push_back(walls.test(index) ? '#' : passages.test(index) ? '.' : '?');
+                }
+                sheet.push_back('\n');
+            }
+
+            const auto draw_start = [&sheet, width, height](const int index, const char start) {
+                const auto x = index % Board::stride - 1;
+                const auto y = index / Board::stride - 1;
+                sheet[(height - 1 - y) * (width + 1) + x] = start;
+            };
+            draw_start(m_start + this_shift, this_start);
+            draw_start(pal.m_start + other_shift, other_start);
+            // The map belongs to the caller, so it stays live in the ledger
+            memory::countAllocation(memory::Subsystem::Maps, sheet.capacity());
+            return sheet;
+        }
+        return std::string();
+    }
+
+    template <int W, int H>
+    void Pal<W, H>::updateNode(const unsigned char mask) noexcept
+    {
+        m_paused = false;
+        const auto directions = {
+            graph::Direction::Left,
+            graph::Direction::Right,
+            graph::Direction::Up,
+            graph::Direction::Down
+        };
+
+        for (const auto& direction : directions) {
+            const auto index = step(m_current, direction);
+            if ((mask & (1 << static_cast<int>(direction))) && !m_passages.test(index)) {
+                const auto x = index % Board::stride;
+                const auto y = index / Board::stride;
+                m_passages.set(index);
+                m_fingerprint.add(graph::Position(x, y));
+                m_rectangle.min_x = x < m_rectangle.min_x ? x : m_rectangle.min_x;
+                m_rectangle.min_y = y < m_rectangle.min_y ? y : m_rectangle.min_y;
+                m_rectangle.max_x = x > m_rectangle.max_x ? x : m_rectangle.max_x;
+                m_rectangle.max_y = y > m_rectangle.max_y ? y : m_rectangle.max_y;
+            }
+        }
+        pruneFrontier();
+    }
+
+    template <int W, int H>
+    void Pal<W, H>::setBounds(const int width, const int height) noexcept
+    {
+        m_width = width;
+        m_height = height;
+    }
+
+    template <int W, int H>
+    void Pal<W, H>::setBudget(const graph::Budget& budget) noexcept
+    {
+        m_budget = budget;
+    }
+
+    template <int W, int H>
+    typename Pal<W, H>::Board Pal<W, H>::getArea(
+        const int min_x,
+        const int min_y,
+        const int max_x,
+        const int max_y) noexcept
+    {
+        // Element N keeps cells of the frame which lay in columns (rows) before N
+        struct Prefixes {
+            Board columns[Board::width + 1];
+            Board rows[Board::height + 1];
+        };
+        static const auto prefixes = []() {
+            Prefixes result;
+            for (int bound = 1; bound <= Board::width; ++bound) {
+                result.columns[bound] = result.columns[bound - 1];
+                for (int y = 0; y < Board::height; ++y) {
+                    result.columns[bound].set(Board::index(bound - 1, y));
+                }
+            }
+            for (int bound = 1; bound <= Board::height; ++bound) {
+                result.rows[bound] = result.rows[bound - 1];
+                for (int x = 0; x < Board::width; ++x) {
+                    result.rows[bound].set(Board::index(x, bound - 1));
+                }
+            }
+            return result;
+        }();
+
+        const auto clamp = [](const int value, const int limit) { return value < 0 ? 0 : value > limit ? limit : value; };
+        const auto columns = prefixes.columns[clamp(max_x + 1, Board::width)]
+            .without(prefixes.columns[clamp(min_x, Board::width)]);
+        const auto rows = prefixes.rows[clamp(max_y + 1, Board::height)]
+            .without(prefixes.rows[clamp(min_y, Board::height)]);
+        return columns & rows;
+    }
+
+    template <int W, int H>
+    void Pal<W, H>::pruneFrontier() noexcept
+    {
+        if (m_width <= 0 || m_height <= 0) {
+            return;
+        }
+        const auto frontier = m_passages.without(m_visited);
+        if (!frontier.any()) {
+            return;
+        }
+
+        // Cells out of the frame are always outside of the labyrinth, so they are never unknown
+        const auto inside = getArea(
+            m_rectangle.max_x - m_width + 1,
+            m_rectangle.max_y - m_height + 1,
+            m_rectangle.min_x + m_width - 1,
+            m_rectangle.min_y + m_height - 1);
+        const auto unknown = inside.without(m_passages | m_visited.spread());
+        m_visited |= frontier.without(unknown.spread());
+    }
+
+    template <int W, int H>
+    int Pal<W, H>::step(const int index, const graph::Direction direction) noexcept
+    {
+        switch (direction) {
+            case graph::Direction::Left:
+                return index - 1;
+            case graph::Direction::Right:
+                return index + 1;
+            case graph::Direction::Up:
+                return index + Board::stride;
+            default:
+                return index - Board::stride;
+        }
+    }
+
+    template <int W, int H>
+    bool Pal<W, H>::deadendCheck(const int index) noexcept
+    {
+        if (m_deadends.test(index)) {
+            return true;
+        }
+        if (!m_visited.test(index)) {
+            return false;
+        }
+
+        const auto exits = m_passages.without(m_deadends);
+        const int exit_count =
+            static_cast<int>(exits.test(step(index, graph::Direction::Left))) +
+            static_cast<int>(exits.test(step(index, graph::Direction::Right))) +
+            static_cast<int>(exits.test(step(index, graph::Direction::Up))) +
+            static_cast<int>(exits.test(step(index, graph::Direction::Down)));
+        if (exit_count < 2) {
+            m_deadends.set(index);
+            return true;
+        }
+        return false;
+    }
+
+    template <int W, int H>
+    graph::Route Pal<W, H>::findUnvisitedNode() const noexcept
+    {
+        const auto targets = m_passages.without(m_visited);
+
+        // Floods visited nodes layer by layer until the layer touches any target. The paused search goes on
+        // from its frontier
+        size_t distance = 1;
+        Board frontier;
+        frontier.set(m_current);
+        auto seen = frontier;
+        const auto passable = m_deadends.test(m_current) ? m_visited : m_visited.without(m_deadends);
+        if (m_paused) {
+            distance = m_distance;
+            frontier = m_frontier;
+            seen = m_seen;
+            m_paused = false;
+        }
+
+        const auto started = m_budget.microseconds != 0
+            ? std::chrono::steady_clock::now()
+            : std::chrono::steady_clock::time_point();
+        std::uint64_t spent = 0;
+        auto hit = Board();
+        while (true) {
+            if (spent != 0 && (
+                (m_budget.expansions != 0 && spent >= m_budget.expansions) ||
+                (m_budget.microseconds != 0 && std::chrono::steady_clock::now() - started
+                    >= std::chrono::microseconds(m_budget.microseconds)))) {
+                m_frontier = frontier;
+                m_seen = seen;
+                m_distance = distance;
+                m_paused = true;
+                m_budget_hits += 1;
+                return graph::Route();
+            }
+            const auto count = frontier.count();
+            m_expansions += count;
+            spent += count;
+            const auto reached = frontier.spread() & m_passages;
+            hit = reached & targets;
+            if (hit.any()) {
+                break;
+            }
+            frontier = (reached & passable).without(seen);
+            if (!frontier.any()) {
+                return graph::Route();
+            }
+            seen |= frontier;
+            distance += 1;
+        }
+
+        // layers[N] contains cells from which any of the nearest targets is reachable in N steps
+        // through visited nodes only
+        memory::Vector<Board> layers(distance, memory::ArenaAllocator<Board>(nullptr, memory::Subsystem::Search));
+        layers[0] = hit;
+        for (size_t index = 1; index < distance; ++index) {
+            layers[index] = layers[index - 1].spread() & m_visited;
+        }
+
+        const auto directions = {
+            graph::Direction::Left,
+            graph::Direction::Right,
+            graph::Direction::Up,
+            graph::Direction::Down
+        };
+
+        graph::Route route;
+        auto index = m_current;
+        for (size_t remaining = layers.size(); remaining > 0; --remaining) {
+            for (const auto& direction : directions) {
+                const auto next = step(index, direction);
+                if (layers[remaining - 1].test(next)) {
+                    route.push_back(direction);
+                    index = next;
+                    break;
+                }
+            }
+        }
+        return route;
+    }
+
+    template <int W, int H>
+    graph::Rectangle Pal<W, H>::getRectangle() const noexcept
+    {
+        return m_rectangle;
+    }
+}
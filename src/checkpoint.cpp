@@ -0,0 +1,217 @@
+#include "checkpoint.hpp"
+#include "fairy_tail.hpp"
+#include "game.hpp"
+#include "graph.hpp"
+#include "pathfinder.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace checkpoint {
+    namespace {
+        const char gMagic[8] = { 'V', 'I', 'T', 'P', 'S', 'N', 'P', '1' };
+
+        /// Represents the header of the snapshot
+        struct Header {
+            std::uint64_t width;
+            std::uint64_t height;
+            std::int32_t turn_count;
+            std::int64_t log_offset;
+            std::int32_t ivan_x;
+            std::int32_t ivan_y;
+            std::int32_t elena_x;
+            std::int32_t elena_y;
+        };
+
+        Header parseHeader(std::istream& input)
+        {
+            char magic[sizeof(gMagic)];
+            if (!input.read(magic, sizeof(magic)) || std::memcmp(magic, gMagic, sizeof(gMagic)) != 0) {
+                throw std::runtime_error("Not a snapshot file");
+            }
+            return binary::read<Header>(input);
+        }
+    }
+
+    /* Writer */
+
+    Writer::Writer(const std::string& t_path, const double t_interval)
+        : m_path(t_path),
+        m_interval(t_interval),
+        m_last(std::chrono::steady_clock::now()),
+        m_busy(false),
+        m_failed(false),
+        m_written(0)
+    {}
+
+    Writer::~Writer()
+    {
+        if (m_worker.joinable()) {
+            m_worker.join();
+        }
+    }
+
+    size_t Writer::getWritten() const noexcept
+    {
+        return m_written.load();
+    }
+
+    bool Writer::hasFailed() const noexcept
+    {
+        return m_failed.load();
+    }
+
+    bool Writer::isDue() const noexcept
+    {
+        return !m_path.empty() && std::chrono::steady_clock::now() - m_last >= m_interval;
+    }
+
+    bool Writer::offer(std::string snapshot)
+    {
+        if (m_busy.load()) {
+            return false;
+        }
+        if (m_worker.joinable()) {
+            m_worker.join();
+        }
+
+        m_buffer = std::move(snapshot);
+        m_last = std::chrono::steady_clock::now();
+        m_busy.store(true);
+        m_worker = std::thread([this]() {
+            const auto temporary = m_path + ".tmp";
+            {
+                std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+                file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+                file.close();
+                if (!file) {
+                    m_failed.store(true);
+                    m_busy.store(false);
+                    return;
+                }
+            }
+            // Rename doesn't replace existing files on some systems
+            if (std::rename(temporary.c_str(), m_path.c_str()) != 0) {
+                std::remove(m_path.c_str());
+                if (std::rename(temporary.c_str(), m_path.c_str()) != 0) {
+                    m_failed.store(true);
+                    m_busy.store(false);
+                    return;
+                }
+            }
+            m_written.fetch_add(1);
+            m_busy.store(false);
+        });
+        return true;
+    }
+
+    void Writer::wait()
+    {
+        if (m_worker.joinable()) {
+            m_worker.join();
+        }
+    }
+
+    /* Functions */
+
+    void writeHeader(std::ostream& output, Fairyland& world)
+    {
+        const auto ivan = world.getPosition(Character::Ivan);
+        const auto elena = world.getPosition(Character::Elena);
+
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        header.width = world.getWidth();
+        header.height = world.getHeight();
+        header.turn_count = world.getTurnCount();
+        header.log_offset = world.getLogOffset();
+        header.ivan_x = ivan.first;
+        header.ivan_y = ivan.second;
+        header.elena_x = elena.first;
+        header.elena_y = elena.second;
+
+        output.write(gMagic, sizeof(gMagic));
+        binary::write(output, header);
+    }
+
+    void readHeader(std::istream& input, Fairyland& world, const std::string& log)
+    {
+        const auto header = parseHeader(input);
+        if (header.width != world.getWidth() || header.height != world.getHeight()) {
+            throw std::runtime_error("Snapshot was taken in another labyrinth");
+        }
+        if (static_cast<std::int64_t>(log.size()) != header.log_offset) {
+            throw std::runtime_error("Move log doesn't match the snapshot");
+        }
+        world.restore(
+            std::make_pair(header.ivan_x, header.ivan_y),
+            std::make_pair(header.elena_x, header.elena_y),
+            header.turn_count,
+            log);
+    }
+
+    Snapshot read(const std::string& path, const std::string& log_path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Snapshot " + path + " not found");
+        }
+
+        Snapshot snapshot;
+        snapshot.data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+        std::istringstream input(snapshot.data);
+        const auto header = parseHeader(input);
+        if (header.log_offset > 0) {
+            std::ifstream log(log_path, std::ios::binary);
+            snapshot.log.resize(static_cast<size_t>(header.log_offset));
+            if (!log.read(&snapshot.log[0], header.log_offset)) {
+                throw std::runtime_error("Move log " + log_path + " is shorter than the snapshot expects");
+            }
+        }
+        return snapshot;
+    }
+
+    game::Result play(const std::shared_ptr<Fairyland>& world, Writer& writer, const Snapshot* snapshot)
+    {
+        const auto ivan_g = std::make_shared<graph::Graph>(std::make_shared<graph::Node>(true));
+        auto ivan_p = pathfinder::Pathfinder(world, Character::Ivan, ivan_g);
+
+        const auto elena_g = std::make_shared<graph::Graph>(std::make_shared<graph::Node>(true));
+        auto elena_p = pathfinder::Pathfinder(world, Character::Elena, elena_g);
+
+        std::unique_ptr<game::Match<pathfinder::Pathfinder>> match;
+        if (snapshot != nullptr) {
+            std::istringstream input(snapshot->data);
+            readHeader(input, *world, snapshot->log);
+            match.reset(new game::Match<pathfinder::Pathfinder>(
+                ivan_p,
+                elena_p,
+                static_cast<int>(world->getWidth()),
+                static_cast<int>(world->getHeight()),
+                input));
+        }
+        else {
+            match.reset(new game::Match<pathfinder::Pathfinder>(
+                ivan_p,
+                elena_p,
+                world->getOpenMask(Character::Ivan),
+                world->getOpenMask(Character::Elena),
+                static_cast<int>(world->getWidth()),
+                static_cast<int>(world->getHeight())));
+        }
+
+        const auto on_turn = [&world, &writer](const game::Match<pathfinder::Pathfinder>& current) {
+            if (writer.isDue() && current.isAdvising()) {
+                writer.offer(capture(*world, current));
+            }
+        };
+        const auto result = game::play(*world, *match, on_turn);
+        writer.wait();
+        return result;
+    }
+}
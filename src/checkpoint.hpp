@@ -0,0 +1,97 @@
+#pragma once
+
+#include "binary.hpp"
+#include "fairy_tail.hpp"
+#include "game.hpp"
+#include "pathfinder.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace checkpoint {
+    /// Represents the saved game. It must be read before the world is created because the world rewrites output.txt
+    struct Snapshot {
+        std::string data;  //!< The whole snapshot file
+        std::string log;   //!< Moves which were written to output.txt before the snapshot was taken
+    };
+
+    /// Writes snapshots to the file in the background. Snapshot is written to the temporary file which replaces
+    /// the previous snapshot only when it is complete, so a crash never leaves a broken snapshot.
+    /// One snapshot is being written while the game fills the next one, and the next one is dropped when
+    /// the previous is still being written
+    class Writer {
+    public:
+        /// @param t_path Path of the snapshot file. Empty path disables snapshots
+        /// @param t_interval Least amount of seconds between snapshots
+        Writer(const std::string& t_path, const double t_interval);
+        Writer(const Writer&) = delete;
+        Writer& operator = (const Writer&) = delete;
+        ~Writer();
+
+    public:
+        /// @returns Amount of snapshots which were written
+        size_t getWritten() const noexcept;
+
+        /// @returns True when any snapshot could not be written
+        bool hasFailed() const noexcept;
+
+        /// @returns True when it's time to take the snapshot
+        bool isDue() const noexcept;
+
+        /// Starts writing of the snapshot in the background
+        ///
+        /// @returns False when the snapshot is dropped because the previous one is still being written
+        bool offer(std::string snapshot);
+
+        /// Waits until the last snapshot is written
+        void wait();
+
+    private:
+        std::string m_path;
+        std::chrono::duration<double> m_interval;
+        std::chrono::steady_clock::time_point m_last;
+        std::string m_buffer;  //!< Snapshot which is being written
+        std::thread m_worker;
+        std::atomic<bool> m_busy;
+        std::atomic<bool> m_failed;
+        std::atomic<size_t> m_written;
+    };
+
+    /// Writes the header of the snapshot: labyrinth size, turn count, move log offset and positions of pals
+    void writeHeader(std::ostream& output, Fairyland& world);
+
+    /// Reads the header written by checkpoint::writeHeader and restores the world
+    ///
+    /// @throws std::runtime_error when the snapshot is corrupted or was taken in another labyrinth
+    void readHeader(std::istream& input, Fairyland& world, const std::string& log);
+
+    /// Takes the snapshot of the world and the match. Must be used only when Match::isAdvising is true
+    template <typename Pal>
+    std::string capture(Fairyland& world, const game::Match<Pal>& match)
+    {
+        std::ostringstream output;
+        writeHeader(output, world);
+        match.save(output);
+        return output.str();
+    }
+
+    /// Reads the snapshot file and moves which were written before it to the log file
+    ///
+    /// @param path Path of the snapshot file
+    /// @param log_path Path of the move log which the world writes
+    ///
+    /// @throws std::runtime_error when files cannot be read or the log is shorter than the snapshot expects
+    Snapshot read(const std::string& path, const std::string& log_path);
+
+    /// Plays the whole game like game::play using graph::Graph with pathfinder::Pathfinder and offers snapshots
+    /// to the writer when new advices are about to be taken
+    ///
+    /// @param snapshot The snapshot to resume from or nullptr to start the new game
+    game::Result play(const std::shared_ptr<Fairyland>& world, Writer& writer, const Snapshot* snapshot);
+}
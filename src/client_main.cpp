@@ -0,0 +1,132 @@
+#include "pipeline.hpp"
+#include "server.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/// Reads all labyrinths of the corpus as they are. Labyrinths in the corpus are separated by empty lines
+///
+/// @param path Path to the corpus file
+std::vector<std::string> read_corpus(const char* path)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error(std::string("Corpus not found: ") + path);
+    }
+
+    std::vector<std::string> labyrinths;
+    std::string labyrinth;
+    while (pipeline::readLabyrinth(file, labyrinth)) {
+        labyrinths.push_back(labyrinth);
+    }
+    return labyrinths;
+}
+
+/// Writes the line of the response in the same format as the batch mode does: index verdict turn_count
+void print_response(const size_t index, const std::string& response)
+{
+    std::istringstream lines(response);
+    std::string verdict = "invalid";
+    std::string turns = "0";
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.compare(0, 8, "verdict ") == 0) {
+            verdict = line.substr(8);
+        }
+        else if (line.compare(0, 6, "turns ") == 0) {
+            turns = line.substr(6);
+        }
+    }
+    std::cout << index << ' ' << verdict << ' ' << turns << '\n';
+}
+
+/// Sends labyrinths one by one through the socket and waits for each response, so latency of every request is
+/// measured from the client side
+int run_socket(const std::string& path, const std::vector<std::string>& labyrinths)
+{
+    const auto socket = server::Socket::connect(path);
+    std::istream input(socket.get());
+    std::ostream output(socket.get());
+
+    std::vector<double> latencies;
+    std::string response;
+    for (size_t index = 0; index < labyrinths.size(); ++index) {
+        const auto begin = std::chrono::steady_clock::now();
+        server::writeFrame(output, labyrinths[index]);
+        output.flush();
+        if (!server::readFrame(input, response)) {
+            throw std::runtime_error("Server has closed the connection");
+        }
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count());
+        print_response(index, response);
+    }
+
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        double sum = 0;
+        for (const auto latency : latencies) {
+            sum += latency;
+        }
+        std::cerr << latencies.size() << " requests, latency us: mean " << sum / latencies.size()
+            << ", p50 " << latencies[latencies.size() / 2]
+            << ", p99 " << latencies[latencies.size() * 99 / 100]
+            << ", max " << latencies.back() << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    // Usage: Volga-IT-Pathfinder-Client --socket PATH corpus.txt
+    //        Volga-IT-Pathfinder-Client --encode corpus.txt > requests
+    //        Volga-IT-Pathfinder-Client --decode < responses
+    std::string socket_path;
+    bool encode = false;
+    bool decode = false;
+    const char* corpus = nullptr;
+    for (int index = 1; index < argc; ++index) {
+        if (strcmp("--socket", argv[index]) == 0 && index + 1 < argc) {
+            socket_path = argv[++index];
+        }
+        else if (strcmp("--encode", argv[index]) == 0) {
+            encode = true;
+        }
+        else if (strcmp("--decode", argv[index]) == 0) {
+            decode = true;
+        }
+        else {
+            corpus = argv[index];
+        }
+    }
+    const auto modes = static_cast<int>(!socket_path.empty()) + static_cast<int>(encode) + static_cast<int>(decode);
+    if (modes != 1 || (corpus == nullptr) != decode) {
+        std::cerr << "Usage: " << argv[0] << " --socket PATH corpus.txt | --encode corpus.txt | --decode" << std::endl;
+        return 1;
+    }
+
+    // Responses of the server which reads stdin are printed like responses of the socket
+    if (decode) {
+        std::string response;
+        for (size_t index = 0; server::readFrame(std::cin, response); ++index) {
+            print_response(index, response);
+        }
+        return 0;
+    }
+
+    const auto labyrinths = read_corpus(corpus);
+    if (encode) {
+        for (const auto& labyrinth : labyrinths) {
+            server::writeFrame(std::cout, labyrinth);
+        }
+        std::cout.flush();
+        return 0;
+    }
+    return run_socket(socket_path, labyrinths);
+}
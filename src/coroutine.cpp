@@ -0,0 +1,174 @@
+#include "bitboard.hpp"
+#include "coroutine.hpp"
+#include "fairy_tail.hpp"
+#include "game.hpp"
+#include "graph.hpp"
+#include "pathfinder.hpp"
+
+#include <atomic>
+#include <new>
+#include <utility>
+
+namespace coroutine {
+    namespace {
+        /// Bytes of coroutine frames which exist right now
+        std::atomic<std::size_t> gFrameBytes(0);
+    }
+
+    /* Game::promise_type */
+
+    Game Game::promise_type::get_return_object() noexcept
+    {
+        return Game(Handle::from_promise(*this));
+    }
+
+    std::suspend_always Game::promise_type::initial_suspend() noexcept
+    {
+        return std::suspend_always();
+    }
+
+    std::suspend_always Game::promise_type::final_suspend() noexcept
+    {
+        return std::suspend_always();
+    }
+
+    void Game::promise_type::return_value(game::Result t_result) noexcept
+    {
+        result = std::move(t_result);
+    }
+
+    void Game::promise_type::unhandled_exception() noexcept
+    {
+        error = std::current_exception();
+    }
+
+    void* Game::promise_type::operator new(const std::size_t size)
+    {
+        gFrameBytes.fetch_add(size);
+        return ::operator new(size);
+    }
+
+    void Game::promise_type::operator delete(void* pointer, const std::size_t size) noexcept
+    {
+        gFrameBytes.fetch_sub(size);
+        ::operator delete(pointer);
+    }
+
+    /* Game */
+
+    Game::Game(const Handle t_handle) noexcept : m_handle(t_handle) {}
+
+    Game::Game(Game&& other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+
+    Game& Game::operator = (Game&& other) noexcept
+    {
+        if (this != &other) {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    Game::~Game()
+    {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    bool Game::step()
+    {
+        if (m_handle.done()) {
+            return false;
+        }
+        m_handle.resume();
+        if (m_handle.promise().error) {
+            std::rethrow_exception(m_handle.promise().error);
+        }
+        return !m_handle.done();
+    }
+
+    const game::Result& Game::getResult() const noexcept
+    {
+        return m_handle.promise().result;
+    }
+
+    /* Scheduler */
+
+    Scheduler::Scheduler(const std::size_t t_window) noexcept
+        : m_window(t_window > 0 ? t_window : 1), m_peak_games(0), m_peak_frame_bytes(0)
+    {}
+
+    std::size_t Scheduler::getPeakGames() const noexcept
+    {
+        return m_peak_games;
+    }
+
+    std::size_t Scheduler::getPeakFrameBytes() const noexcept
+    {
+        return m_peak_frame_bytes;
+    }
+
+    std::vector<game::Result> Scheduler::run(const std::vector<std::shared_ptr<Fairyland>>& worlds)
+    {
+        auto results = std::vector<game::Result>(
+            worlds.size(),
+            game::Result(game::Verdict::AlgorithmError, 0, std::string()));
+
+        // Games and indices of their worlds are kept side by side, the finished game is replaced in place
+        std::vector<Game> games;
+        std::vector<std::size_t> indices;
+        games.reserve(m_window);
+        indices.reserve(m_window);
+
+        const auto frames = getFrameBytes();
+        std::size_t next = 0;
+        while (next < worlds.size() || !games.empty()) {
+            while (games.size() < m_window && next < worlds.size()) {
+                games.push_back(play(worlds[next]));
+                indices.push_back(next);
+                next += 1;
+            }
+            m_peak_games = games.size() > m_peak_games ? games.size() : m_peak_games;
+            const auto frame_bytes = getFrameBytes() - frames;
+            m_peak_frame_bytes = frame_bytes > m_peak_frame_bytes ? frame_bytes : m_peak_frame_bytes;
+
+            for (std::size_t slot = 0; slot < games.size();) {
+                if (games[slot].step()) {
+                    slot += 1;
+                    continue;
+                }
+                results[indices[slot]] = games[slot].getResult();
+                games[slot] = std::move(games.back());
+                indices[slot] = indices.back();
+                games.pop_back();
+                indices.pop_back();
+            }
+        }
+        return results;
+    }
+
+    /* Functions */
+
+    std::size_t getFrameBytes() noexcept
+    {
+        return gFrameBytes.load();
+    }
+
+    Game play(const std::shared_ptr<Fairyland>& world)
+    {
+        if (bitboard::Pal<10, 10>::fits(world->getWidth(), world->getHeight())) {
+            return play(world, bitboard::Pal<10, 10>(), bitboard::Pal<10, 10>());
+        }
+
+        // Graphs live as long as the game, so they use the global heap instead of the arena
+        const auto ivan_g = std::make_shared<graph::Graph>(graph::Graph::makeNode(nullptr, true));
+        const auto elena_g = std::make_shared<graph::Graph>(graph::Graph::makeNode(nullptr, true));
+        return play(
+            world,
+            pathfinder::Pathfinder(world, Character::Ivan, ivan_g),
+            pathfinder::Pathfinder(world, Character::Elena, elena_g));
+    }
+}
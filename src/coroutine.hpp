@@ -0,0 +1,119 @@
+#pragma once
+
+#include "bitboard.hpp"
+#include "fairy_tail.hpp"
+#include "game.hpp"
+#include "graph.hpp"
+#include "pathfinder.hpp"
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/// Games as C++20 coroutines. Only the scheduler executable is built with C++20, so the rest of the solver must
+/// not include this header
+namespace coroutine {
+    /// Represents the game which is played by the coroutine. Every resume plays exactly one turn, so the whole state
+    /// of the game stays in the coroutine frame between turns and any amount of games can share one thread.
+    /// Decisions are made by game::Match, so results are the same as game::play gives
+    class Game {
+    public:
+        struct promise_type {
+            game::Result result = game::Result(game::Verdict::AlgorithmError, 0, std::string());
+            std::exception_ptr error;
+
+            Game get_return_object() noexcept;
+            std::suspend_always initial_suspend() noexcept;
+            std::suspend_always final_suspend() noexcept;
+            void return_value(game::Result t_result) noexcept;
+            void unhandled_exception() noexcept;
+
+            /// Frames are counted by getFrameBytes
+            static void* operator new(const std::size_t size);
+            static void operator delete(void* pointer, const std::size_t size) noexcept;
+        };
+
+        Game(Game&& other) noexcept;
+        Game& operator = (Game&& other) noexcept;
+        Game(const Game&) = delete;
+        Game& operator = (const Game&) = delete;
+        ~Game();
+
+    public:
+        /// Plays the next turn of the game
+        ///
+        /// @returns False when the game is over. Turn is not played in that case
+        ///
+        /// @throws What the game has thrown: std::runtime_error when the pathfinder gives invalid direction
+        bool step();
+
+        /// @returns Result of the game. Makes sense only when Game::step returned false
+        const game::Result& getResult() const noexcept;
+
+    private:
+        using Handle = std::coroutine_handle<promise_type>;
+
+        explicit Game(const Handle t_handle) noexcept;
+
+    private:
+        Handle m_handle;
+    };
+
+    /// Plays games of many worlds on the calling thread. Every round resumes each game once, finished games are
+    /// replaced by games of the next worlds, so at most the window of games is kept at once
+    class Scheduler {
+    public:
+        /// @param t_window Max amount of games which are played at once
+        explicit Scheduler(const std::size_t t_window) noexcept;
+
+    public:
+        /// @returns The highest amount of games which were played at once by Scheduler::run
+        std::size_t getPeakGames() const noexcept;
+
+        /// @returns The highest amount of bytes of coroutine frames which were kept at once by Scheduler::run
+        std::size_t getPeakFrameBytes() const noexcept;
+
+        /// Plays games in every world. Worlds are changed by their games
+        ///
+        /// @throws std::runtime_error when the pathfinder gives invalid direction
+        ///
+        /// @returns Results in the same order as worlds are
+        std::vector<game::Result> run(const std::vector<std::shared_ptr<Fairyland>>& worlds);
+
+    private:
+        std::size_t m_window;
+        std::size_t m_peak_games;
+        std::size_t m_peak_frame_bytes;
+    };
+
+    /// @returns Bytes of coroutine frames of all games which exist right now
+    std::size_t getFrameBytes() noexcept;
+
+    /// Starts the game in the world. Bitboard engine is selected when the labyrinth fits it like game::play does.
+    /// The game doesn't play any turn until Game::step
+    Game play(const std::shared_ptr<Fairyland>& world);
+
+    /// Starts the game of the pals in the world. Pals are kept in the coroutine frame
+    template <typename Pal>
+    Game play(std::shared_ptr<Fairyland> world, Pal ivan, Pal elena)
+    {
+        game::Match<Pal> match(
+            ivan,
+            elena,
+            world->getOpenMask(Character::Ivan),
+            world->getOpenMask(Character::Elena),
+            static_cast<int>(world->getWidth()),
+            static_cast<int>(world->getHeight()));
+
+        auto turn = game::Turn(Direction::Pass, Direction::Pass);
+        while (match.next(turn)) {
+            const auto meeting = world->go(turn.ivan, turn.elena);
+            match.commit(meeting, world->getOpenMask(Character::Ivan), world->getOpenMask(Character::Elena));
+            co_await std::suspend_always();
+        }
+        co_return game::conclude(*world, match);
+    }
+}
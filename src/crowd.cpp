@@ -0,0 +1,142 @@
+#include "crowd.hpp"
+#include "fairy_tail.hpp"
+#include "graph.hpp"
+#include "memory.hpp"
+#include "pathfinder.hpp"
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace crowd {
+    namespace {
+        /// @returns The root agent of the agent's group
+        size_t findGroup(std::vector<size_t>& parents, size_t agent) noexcept
+        {
+            while (parents[agent] != agent) {
+                parents[agent] = parents[parents[agent]];
+                agent = parents[agent];
+            }
+            return agent;
+        }
+
+        /// Joins groups of two agents
+        ///
+        /// @returns True when agents were in different groups
+        bool joinGroups(std::vector<size_t>& parents, const size_t first, const size_t second) noexcept
+        {
+            const auto first_root = findGroup(parents, first);
+            const auto second_root = findGroup(parents, second);
+            if (first_root == second_root) {
+                return false;
+            }
+            parents[second_root] = first_root;
+            return true;
+        }
+    }
+
+    /* Result */
+
+    Result::Result(const bool t_gathered, const int t_turn_count, const size_t t_agents, const size_t t_groups) noexcept
+        : gathered(t_gathered), turn_count(t_turn_count), agents(t_agents), groups(t_groups)
+    {}
+
+    /* Functions */
+
+    Result gather(const std::shared_ptr<Fairyland>& world, memory::Arena& arena)
+    {
+        const auto count = world->getAgentCount();
+        auto groups = count;
+        std::vector<size_t> parents(count);
+        for (size_t agent = 0; agent < count; ++agent) {
+            parents[agent] = agent;
+        }
+
+        // Agents who start in the same cell have already met
+        std::unordered_map<long long, size_t> starts;
+        for (size_t agent = 0; agent < count; ++agent) {
+            const auto pos = world->getPosition(agent);
+            const auto key = static_cast<long long>(pos.second) * static_cast<long long>(world->getWidth()) + pos.first;
+            const auto inserted = starts.emplace(key, agent);
+            if (!inserted.second && joinGroups(parents, inserted.first->second, agent)) {
+                groups -= 1;
+            }
+        }
+
+        {
+            // Pathfinders and advices must be destroyed before the arena is reset
+            std::vector<pathfinder::Pathfinder> pals;
+            pals.reserve(count);
+            for (size_t agent = 0; agent < count; ++agent) {
+                const auto graph = std::allocate_shared<graph::Graph>(
+                    memory::ArenaAllocator<graph::Graph>(&arena), graph::Graph::makeNode(&arena, true), &arena);
+                pals.emplace_back(world, agent, graph);
+            }
+
+            // State of agents is kept as separate arrays which are walked once per turn
+            std::vector<unsigned char> masks;
+            std::vector<pathfinder::Advice> advices(count, pathfinder::Advice(pathfinder::AdviceType::Rendezvous));
+            std::vector<size_t> steps(count, 0);
+            std::vector<char> explored(count, 0);
+            std::vector<Direction> directions(count, Direction::Pass);
+            std::vector<std::pair<size_t, size_t>> meetings;
+
+            world->sense(masks);
+            for (size_t agent = 0; agent < count; ++agent) {
+                pals[agent].updateNode(masks[agent]);
+                pals[agent].deadendCheck();
+            }
+
+            while (groups > 1) {
+                bool moving = false;
+                for (size_t agent = 0; agent < count; ++agent) {
+                    directions[agent] = Direction::Pass;
+                    if (explored[agent]) {
+                        continue;
+                    }
+                    if (steps[agent] >= advices[agent].route.size()) {
+                        advices[agent] = pals[agent].getAdvice();
+                        steps[agent] = 0;
+                    }
+                    // Agent who has explored the reachable part of the labyrinth waits for others
+                    if (advices[agent].type == pathfinder::AdviceType::Rendezvous) {
+                        explored[agent] = 1;
+                        continue;
+                    }
+                    directions[agent] = advices[agent].route[steps[agent]].world;
+                    moving = true;
+                }
+                if (!moving) {
+                    break;
+                }
+
+                world->goAgents(directions, meetings);
+                world->sense(masks);
+                for (size_t agent = 0; agent < count; ++agent) {
+                    if (directions[agent] != Direction::Pass) {
+                        pals[agent].go(advices[agent].route[steps[agent]].graph, masks[agent]);
+                        steps[agent] += 1;
+                    }
+                }
+                for (const auto& meeting : meetings) {
+                    if (joinGroups(parents, meeting.first, meeting.second)) {
+                        groups -= 1;
+                    }
+                }
+            }
+        }
+        arena.reset();
+        return Result(groups == 1, world->getTurnCount(), count, groups);
+    }
+
+    void report(std::ostream& output, const Result& result)
+    {
+        if (result.gathered) {
+            output << "All " << result.agents << " agents had gathered!" << std::endl;
+        }
+        else {
+            output << "Agents cannot gather! Groups: " << result.groups << std::endl;
+        }
+        output << "Turn count: " << result.turn_count << std::endl;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "fairy_tail.hpp"
+#include "memory.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+
+namespace crowd {
+    /// Represents the result of the gathering
+    struct Result {
+        bool gathered;    //!< True when every agent is linked with all others by meetings
+        int turn_count;   //!< Turn count of the world at the end of the gathering
+        size_t agents;    //!< Amount of agents
+        size_t groups;    //!< Amount of groups of agents who are linked by meetings
+
+        Result(const bool t_gathered, const int t_turn_count, const size_t t_agents, const size_t t_groups) noexcept;
+    };
+
+    /// Gathers all agents of the world. Every agent explores the labyrinth with its own pathfinder, all agents
+    /// move at once every turn and two agents who met join their groups. The gathering is over when only one group
+    /// is left or when nobody has unvisited nodes
+    ///
+    /// @param arena Arena of the run which keeps graphs of all agents. It is reset when the gathering is over
+    Result gather(const std::shared_ptr<Fairyland>& world, memory::Arena& arena);
+
+    /// Writes the result in the same manner as game::report does
+    void report(std::ostream& output, const Result& result);
+}
@@ -0,0 +1,190 @@
+#include "embed.h"
+#include "fairy_tail.hpp"
+#include "game.hpp"
+#include "memory.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+
+namespace {
+    /// Represents the read-only stream buffer over the caller's memory, so the labyrinth is parsed in place
+    class View : public std::streambuf {
+    public:
+        View(const char* t_data, const size_t t_size) noexcept
+        {
+            // The get area is never written by std::streambuf, so the caller's memory stays untouched
+            const auto data = const_cast<char*>(t_data);
+            setg(data, data, data + t_size);
+        }
+    };
+
+    /// Writes the text to the caller's buffer
+    ///
+    /// @returns False when the buffer is too small and only its capacity is written
+    bool put(vpf_buffer& buffer, const std::string& text) noexcept
+    {
+        const auto capacity = buffer.data != nullptr ? buffer.capacity : 0;
+        buffer.size = text.size();
+        if (!text.empty() && capacity > 0) {
+            std::memcpy(buffer.data, text.data(), std::min(text.size(), capacity));
+        }
+        return text.size() <= capacity;
+    }
+}
+
+/// Represents the solver. Its arena keeps chunks and its texts keep capacity between games, so warm games make no
+/// calls to the global heap
+struct vpf_solver {
+    memory::Arena arena;
+    graph::Budget budget;
+    bool tiered = false;
+    std::unique_ptr<game::Partner> partner;  //!< Thread of Elena's searches when the parallel mode is enabled
+
+    // Result of the last game
+    int verdict = VPF_VERDICT_INVALID;
+    int turn_count = 0;
+    std::uint64_t budget_hits = 0;
+    std::string moves;
+    std::string map;
+    std::string message;
+};
+
+int vpf_abi_version(void)
+{
+    return VPF_ABI_VERSION;
+}
+
+vpf_solver* vpf_solver_create(void)
+{
+    try {
+        return new vpf_solver();
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+void vpf_solver_destroy(vpf_solver* solver)
+{
+    delete solver;
+}
+
+void vpf_solver_set_budget(vpf_solver* solver, uint64_t expansions, uint64_t microseconds)
+{
+    if (solver != nullptr) {
+        solver->budget = graph::Budget(expansions, microseconds);
+    }
+}
+
+void vpf_solver_set_tiering(vpf_solver* solver, int enabled)
+{
+    if (solver != nullptr) {
+        solver->tiered = enabled != 0;
+    }
+}
+
+void vpf_solver_set_parallel(vpf_solver* solver, int enabled)
+{
+    if (solver == nullptr) {
+        return;
+    }
+    if (enabled == 0) {
+        solver->partner.reset();
+        return;
+    }
+    // Without the thread the solver stays sequential, so the failure is not reported
+    try {
+        if (!solver->partner) {
+            solver->partner.reset(new game::Partner());
+        }
+    }
+    catch (...) {
+    }
+}
+
+int vpf_solve(vpf_solver* solver, const char* labyrinth, size_t size, vpf_result* result)
+{
+    if (solver == nullptr || result == nullptr || (labyrinth == nullptr && size > 0)) {
+        return VPF_FAILURE;
+    }
+
+    // Exceptions must not leave the C ABI
+    try {
+        solver->moves.clear();
+        solver->map.clear();
+        solver->message.clear();
+        solver->turn_count = 0;
+        solver->budget_hits = 0;
+
+        std::shared_ptr<Fairyland> world;
+        try {
+            View view(labyrinth, size);
+            std::istream input(&view);
+            world = std::make_shared<Fairyland>(input);
+        }
+        catch (const std::exception& error) {
+            solver->verdict = VPF_VERDICT_INVALID;
+            solver->message = error.what();
+            return vpf_fetch(solver, result);
+        }
+
+        // Moves are appended to the kept string turn by turn, since the caller's buffer may be too small for them
+        world->setLog(&solver->moves);
+        try {
+            auto outcome = game::play(world, solver->arena, solver->budget, solver->tiered, solver->partner.get());
+            switch (outcome.verdict) {
+                case game::Verdict::Met:
+                    solver->verdict = VPF_VERDICT_MET;
+                    break;
+                case game::Verdict::CannotMeet:
+                    solver->verdict = VPF_VERDICT_CANNOT_MEET;
+                    break;
+                default:
+                    solver->verdict = VPF_VERDICT_ERROR;
+                    break;
+            }
+            solver->turn_count = outcome.turn_count;
+            solver->budget_hits = outcome.budget_hits;
+            solver->map = std::move(outcome.map);
+            solver->message = std::move(outcome.message);
+        }
+        catch (const std::exception& error) {
+            // The game was broken by the invalid advice, so its memory is not released by game::play
+            solver->arena.reset();
+            if (solver->partner) {
+                solver->partner->getArena().reset();
+            }
+            solver->verdict = VPF_VERDICT_ERROR;
+            solver->turn_count = world->getTurnCount();
+            solver->message = error.what();
+        }
+        return vpf_fetch(solver, result);
+    }
+    catch (...) {
+        solver->arena.reset();
+        if (solver->partner) {
+            solver->partner->getArena().reset();
+        }
+        return VPF_FAILURE;
+    }
+}
+
+int vpf_fetch(const vpf_solver* solver, vpf_result* result)
+{
+    if (solver == nullptr || result == nullptr) {
+        return VPF_FAILURE;
+    }
+    result->verdict = solver->verdict;
+    result->turn_count = solver->turn_count;
+    result->budget_hits = solver->budget_hits;
+    // Every buffer is written even when the previous one is truncated, so the caller learns all sizes at once
+    const auto moves = put(result->moves, solver->moves);
+    const auto map = put(result->map, solver->map);
+    const auto message = put(result->message, solver->message);
+    return moves && map && message ? VPF_OK : VPF_TRUNCATED;
+}
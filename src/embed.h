@@ -0,0 +1,102 @@
+#pragma once
+
+/* Embeddable solver with the stable C ABI. The labyrinth is read from the caller's buffer as input.txt has it and
+ * the result is written to the caller's buffers, so the host process needs neither files nor the executable:
+ *
+ *     vpf_solver* solver = vpf_solver_create();
+ *     char moves[4096], map[4096], message[256];
+ *     vpf_result result = { 0 };
+ *     result.moves.data = moves;     result.moves.capacity = sizeof(moves);
+ *     result.map.data = map;         result.map.capacity = sizeof(map);
+ *     result.message.data = message; result.message.capacity = sizeof(message);
+ *     if (vpf_solve(solver, labyrinth, labyrinth_size, &result) == VPF_TRUNCATED) {
+ *         // Grow buffers up to result.*.size and call vpf_fetch, the game is not played again
+ *     }
+ *     vpf_solver_destroy(solver);
+ *
+ * Structures are only extended at the end and VPF_ABI_VERSION is raised when it happens */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(VPF_SHARED)
+#if defined(VPF_BUILDING)
+#define VPF_API __declspec(dllexport)
+#else
+#define VPF_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__) || defined(__clang__)
+#define VPF_API __attribute__((visibility("default")))
+#else
+#define VPF_API
+#endif
+
+#define VPF_ABI_VERSION 2
+
+/* Verdicts of the game */
+#define VPF_VERDICT_MET 0          /* Pals had met in the labyrinth */
+#define VPF_VERDICT_CANNOT_MEET 1  /* Pals are in the unlinked parts of the labyrinth */
+#define VPF_VERDICT_ERROR 2        /* Pathfinders gave inconsistent advices, see the message */
+#define VPF_VERDICT_INVALID 3      /* Labyrinth cannot be read, see the message */
+
+/* Codes returned by functions */
+#define VPF_OK 0          /* Result is written completely */
+#define VPF_TRUNCATED 1   /* Some buffer is smaller than its size, so only its capacity is written */
+#define VPF_FAILURE (-1)  /* Arguments are null or the memory is over. Buffers are not touched */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Solver which keeps its memory between games. One solver must not be used by many threads at once, but every
+ * thread may have its own solver */
+typedef struct vpf_solver vpf_solver;
+
+/* Buffer which is owned by the caller. The solver writes at most capacity bytes to data and sets size to the whole
+ * size of the text. Texts are not terminated by zero */
+typedef struct vpf_buffer {
+    char* data;
+    size_t capacity;
+    size_t size;
+} vpf_buffer;
+
+/* Result of the game */
+typedef struct vpf_result {
+    int verdict;           /* One of VPF_VERDICT_* */
+    int turn_count;        /* Turn count of the world at the end of the game */
+    uint64_t budget_hits;  /* Searches paused by the budget, 0 when the budget is unlimited */
+    vpf_buffer moves;      /* Moves as output.txt has them without the final XX */
+    vpf_buffer map;        /* Restored map when pals had met, otherwise empty */
+    vpf_buffer message;    /* Reason of VPF_VERDICT_ERROR or VPF_VERDICT_INVALID, otherwise empty */
+} vpf_result;
+
+/* Returns VPF_ABI_VERSION of the library, so the host may check it against the header */
+VPF_API int vpf_abi_version(void);
+
+/* Returns the new solver with the unlimited budget or null when the memory is over */
+VPF_API vpf_solver* vpf_solver_create(void);
+
+/* Destroys the solver. Null is ignored */
+VPF_API void vpf_solver_destroy(vpf_solver* solver);
+
+/* Limits every search of pals, so no turn takes longer than the budget. Zero means unlimited */
+VPF_API void vpf_solver_set_budget(vpf_solver* solver, uint64_t expansions, uint64_t microseconds);
+
+/* Keeps explored blocks of large labyrinths compacted when enabled is not zero */
+VPF_API void vpf_solver_set_tiering(vpf_solver* solver, int enabled);
+
+/* Gives advices of both pals of large labyrinths on two threads when enabled is not zero. The solver keeps the
+ * second thread until it is destroyed or the mode is disabled. Results are the same. Since ABI version 2 */
+VPF_API void vpf_solver_set_parallel(vpf_solver* solver, int enabled);
+
+/* Plays the labyrinth of size bytes and writes the result. The labyrinth is read in place and may be freed as soon
+ * as the function returns. Returns one of VPF_OK, VPF_TRUNCATED or VPF_FAILURE */
+VPF_API int vpf_solve(vpf_solver* solver, const char* labyrinth, size_t size, vpf_result* result);
+
+/* Writes the result of the last game once more, so truncated texts are taken without playing the game again.
+ * Returns one of VPF_OK, VPF_TRUNCATED or VPF_FAILURE */
+VPF_API int vpf_fetch(const vpf_solver* solver, vpf_result* result);
+
+#ifdef __cplusplus
+}
+#endif
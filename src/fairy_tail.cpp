@@ -1,21 +1,43 @@
 #include "fairy_tail.hpp"
 
-Fairyland::Fairyland()
-    : mOutput("output.txt")
-    , mTurnCount(0)
+namespace
 {
-    std::ifstream file("input.txt");
-    check(file.is_open(), "File input.txt not found");
+    const std::size_t gNoAgent = static_cast<std::size_t>(-1);
+}
 
-    mMaze.resize(gSize);
-    for (int y = 0; y < gSize; ++y)
+Maze::Maze(std::istream& input)
+    : mWidth(0)
+    , mHeight(0)
+    , mStarts(2)
+{
+    bool ivan = false;
+    bool elena = false;
+    std::string line;
+    while (std::getline(input, line))
     {
-        mMaze[y].resize(gSize);
-        for (int x = 0; x < gSize; ++x)
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+        {
+            line.pop_back();
+        }
+        if (line.empty())
+        {
+            if (mHeight == 0)
+            {
+                continue;
+            }
+            break;
+        }
+        if (mHeight == 0)
         {
-            char c = 0;
-            file >> c;
-            check(file.good(), "Invalid input file");
+            mWidth = line.size();
+        }
+        Fairyland::check(line.size() == mWidth, "Invalid input file");
+
+        const int y = static_cast<int>(mHeight);
+        mPassages.resize(mPassages.size() + mWidth);
+        for (int x = 0; x < mWidth; ++x)
+        {
+            const char c = line[x];
 
             bool passage = true;
             switch (c)
@@ -25,27 +47,134 @@ Fairyland::Fairyland()
                 break;
 
             case '@':
-                mIvanPos.first = x;
-                mIvanPos.second = y;
+                mStarts[0] = Fairyland::Position(x, y);
+                ivan = true;
                 break;
 
             case '&':
-                mElenaPos.first = x;
-                mElenaPos.second = y;
+                mStarts[1] = Fairyland::Position(x, y);
+                elena = true;
+                break;
+
+            case '*':
+                mStarts.emplace_back(x, y);
                 break;
 
             default:
-                check(c == '.', "Invalid input file");
+                Fairyland::check(c == '.', "Invalid input file");
             }
 
-            mMaze[y][x] = passage;
+            mPassages[y * mWidth + x] = passage;
         }
+        mHeight += 1;
+    }
+    Fairyland::check(ivan && elena, "Invalid input file");
+
+    mMasks.resize(mWidth * mHeight);
+    for (int y = 0; y < mHeight; ++y)
+    {
+        for (int x = 0; x < mWidth; ++x)
+        {
+            unsigned char mask = 0;
+            if (x > 0 && isPassage(x - 1, y))
+            {
+                mask |= Fairyland::bit(Direction::Left);
+            }
+            if (x + 1 < mWidth && isPassage(x + 1, y))
+            {
+                mask |= Fairyland::bit(Direction::Right);
+            }
+            if (y > 0 && isPassage(x, y - 1))
+            {
+                mask |= Fairyland::bit(Direction::Up);
+            }
+            if (y + 1 < mHeight && isPassage(x, y + 1))
+            {
+                mask |= Fairyland::bit(Direction::Down);
+            }
+            mMasks[y * mWidth + x] = mask;
+        }
+    }
+}
+
+std::size_t Maze::getWidth() const
+{
+    return mWidth;
+}
+
+std::size_t Maze::getHeight() const
+{
+    return mHeight;
+}
+
+unsigned char Maze::getOpenMask(int x, int y) const
+{
+    return mMasks[y * mWidth + x];
+}
+
+const std::vector<std::pair<int, int>>& Maze::getStarts() const
+{
+    return mStarts;
+}
+
+bool Maze::isPassage(int x, int y) const
+{
+    return mPassages[y * mWidth + x];
+}
+
+std::shared_ptr<const Maze> Fairyland::loadInput()
+{
+    std::ifstream file("input.txt");
+    check(file.is_open(), "File input.txt not found");
+    return std::make_shared<const Maze>(file);
+}
+
+Fairyland::Fairyland()
+    : Fairyland(loadInput())
+{
+    mOutput.open("output.txt");
+    mLogging = true;
+}
+
+Fairyland::Fairyland(std::istream& input)
+    : Fairyland(std::make_shared<const Maze>(input))
+{
+}
+
+Fairyland::Fairyland(std::shared_ptr<const Maze> maze)
+    : mMaze(std::move(maze))
+    , mLog(nullptr)
+    , mLogging(false)
+    , mTurnCount(0)
+{
+    for (const Position& start : mMaze->getStarts())
+    {
+        mAgentX.push_back(start.first);
+        mAgentY.push_back(start.second);
     }
 }
 
+Fairyland::Fairyland(std::shared_ptr<const Maze> maze, std::pair<int, int> ivanPos, std::pair<int, int> elenaPos)
+    : Fairyland(std::move(maze))
+{
+    const auto inside = [this](const Position& position) {
+        return position.first >= 0 && position.first < getWidth()
+            && position.second >= 0 && position.second < getHeight()
+            && isPassage(position.first, position.second);
+    };
+    check(inside(ivanPos) && inside(elenaPos), "Invalid start positions");
+    mAgentX[0] = ivanPos.first;
+    mAgentY[0] = ivanPos.second;
+    mAgentX[1] = elenaPos.first;
+    mAgentY[1] = elenaPos.second;
+}
+
 Fairyland::~Fairyland()
 {
-    mOutput << "XX" << std::endl;
+    if (mLogging)
+    {
+        mOutput << "XX" << std::endl;
+    }
 }
 
 void Fairyland::check(bool expression, const char* message)
@@ -62,7 +191,22 @@ int Fairyland::getTurnCount() const
     return mTurnCount;
 }
 
-bool Fairyland::move(Position& position, Direction direction)
+std::size_t Fairyland::getWidth() const
+{
+    return mMaze->getWidth();
+}
+
+std::size_t Fairyland::getHeight() const
+{
+    return mMaze->getHeight();
+}
+
+std::shared_ptr<const Maze> Fairyland::getMaze() const
+{
+    return mMaze;
+}
+
+bool Fairyland::move(Position& position, Direction direction) const
 {
     switch (direction)
     {
@@ -72,7 +216,7 @@ bool Fairyland::move(Position& position, Direction direction)
 
     case Direction::Down:
         position.second += 1;
-        return position.second < gSize;
+        return position.second < getHeight();
 
     case Direction::Left:
         position.first -= 1;
@@ -80,17 +224,122 @@ bool Fairyland::move(Position& position, Direction direction)
 
     case Direction::Right:
         position.first += 1;
-        return position.first < gSize;
+        return position.first < getWidth();
 
     default:
         return true;
     }
 }
 
+unsigned char Fairyland::bit(Direction direction)
+{
+    switch (direction)
+    {
+    case Direction::Left:
+        return 1;
+
+    case Direction::Right:
+        return 2;
+
+    case Direction::Up:
+        return 4;
+
+    case Direction::Down:
+        return 8;
+
+    default:
+        return 0;
+    }
+}
+
 bool Fairyland::canGo(Character name, Direction direction) const
 {
-    Position position = (name == Character::Ivan) ? mIvanPos : mElenaPos;
-    return move(position, direction) && mMaze[position.second][position.first];
+    return direction == Direction::Pass || (getOpenMask(name) & bit(direction)) != 0;
+}
+
+unsigned char Fairyland::getOpenMask(Character name) const
+{
+    return getOpenMask(static_cast<std::size_t>(name));
+}
+
+unsigned char Fairyland::getOpenMask(int x, int y) const
+{
+    return mMaze->getOpenMask(x, y);
+}
+
+unsigned char Fairyland::getOpenMask(std::size_t agent) const
+{
+    return mMaze->getOpenMask(mAgentX[agent], mAgentY[agent]);
+}
+
+std::pair<int, int> Fairyland::getPosition(Character name) const
+{
+    return getPosition(static_cast<std::size_t>(name));
+}
+
+std::pair<int, int> Fairyland::getPosition(std::size_t agent) const
+{
+    return Position(mAgentX[agent], mAgentY[agent]);
+}
+
+std::size_t Fairyland::getAgentCount() const
+{
+    return mAgentX.size();
+}
+
+std::size_t Fairyland::addAgent(int x, int y)
+{
+    check(x >= 0 && x < getWidth() && y >= 0 && y < getHeight() && isPassage(x, y), "Invalid agent's position");
+    mAgentX.push_back(x);
+    mAgentY.push_back(y);
+    return mAgentX.size() - 1;
+}
+
+std::size_t Fairyland::getCell(std::size_t agent) const
+{
+    return static_cast<std::size_t>(mAgentY[agent]) * getWidth() + mAgentX[agent];
+}
+
+bool Fairyland::isPassage(int x, int y) const
+{
+    return mMaze->isPassage(x, y);
+}
+
+std::streamoff Fairyland::getLogOffset()
+{
+    if (!mLogging)
+    {
+        return 0;
+    }
+    mOutput.flush();
+    return mOutput.tellp();
+}
+
+void Fairyland::setLog(std::string* log)
+{
+    mLog = log;
+}
+
+void Fairyland::restore(std::pair<int, int> ivanPos, std::pair<int, int> elenaPos, int turnCount, const std::string& log)
+{
+    const auto inside = [this](const Position& position) {
+        return position.first >= 0 && position.first < getWidth()
+            && position.second >= 0 && position.second < getHeight()
+            && isPassage(position.first, position.second);
+    };
+    check(inside(ivanPos) && inside(elenaPos), "Invalid saved positions");
+    check(turnCount >= 0 && turnCount < 1000000, "Invalid saved turn count");
+
+    mAgentX[0] = ivanPos.first;
+    mAgentY[0] = ivanPos.second;
+    mAgentX[1] = elenaPos.first;
+    mAgentY[1] = elenaPos.second;
+    mTurnCount = turnCount;
+    if (mLogging)
+    {
+        mOutput.write(log.data(), log.size());
+        check(mOutput.good(), "Cannot write to file output.txt");
+    }
 }
 
 bool Fairyland::go(Direction directionIvan, Direction directionElena)
@@ -98,17 +347,113 @@ bool Fairyland::go(Direction directionIvan, Direction directionElena)
     check(canGo(Character::Ivan, directionIvan), "Invalid Ivan's direction");
     check(canGo(Character::Elena, directionElena), "Invalid Elena's direction");
 
-    mOutput << static_cast<char>(directionIvan) << static_cast<char>(directionElena);
-    check(mOutput.good(), "Cannot write to file output.txt");
+    // Other agents wait while Ivan and Elena move
+    mDirections.assign(mAgentX.size(), Direction::Pass);
+    mDirections[0] = directionIvan;
+    mDirections[1] = directionElena;
+
+    const Position lastIvanPos = getPosition(Character::Ivan);
+    const Position lastElenaPos = getPosition(Character::Elena);
+
+    moveAgents(mDirections.data());
+
+    const Position ivanPos = getPosition(Character::Ivan);
+    const Position elenaPos = getPosition(Character::Elena);
+    return ivanPos == elenaPos || lastIvanPos == elenaPos && lastElenaPos == ivanPos;
+}
+
+void Fairyland::goAgents(const std::vector<Direction>& directions, std::vector<std::pair<std::size_t, std::size_t>>& meetings)
+{
+    const std::size_t count = mAgentX.size();
+    check(directions.size() == count, "Invalid agents count");
+    mLastCells.resize(count);
+    for (std::size_t agent = 0; agent < count; ++agent)
+    {
+        const Direction direction = directions[agent];
+        check(direction == Direction::Pass || (getOpenMask(agent) & bit(direction)) != 0, "Invalid agent's direction");
+        mLastCells[agent] = getCell(agent);
+    }
+
+    moveAgents(directions.data());
+
+    // Every agent becomes the first one in its cell, so agents which are already there are the met ones
+    meetings.clear();
+    mCellAgents.clear();
+    mNextAgents.assign(count, gNoAgent);
+    for (std::size_t agent = 0; agent < count; ++agent)
+    {
+        const auto inserted = mCellAgents.emplace(getCell(agent), agent);
+        if (inserted.second)
+        {
+            continue;
+        }
+        mNextAgents[agent] = inserted.first->second;
+        inserted.first->second = agent;
+        for (std::size_t other = mNextAgents[agent]; other != gNoAgent; other = mNextAgents[other])
+        {
+            meetings.emplace_back(other, agent);
+        }
+    }
+
+    // Agents passed through each other when each one is in the last cell of another
+    for (std::size_t agent = 0; agent < count; ++agent)
+    {
+        const std::size_t cell = getCell(agent);
+        if (cell == mLastCells[agent])
+        {
+            continue;
+        }
+        const auto found = mCellAgents.find(mLastCells[agent]);
+        if (found == mCellAgents.end())
+        {
+            continue;
+        }
+        for (std::size_t other = found->second; other != gNoAgent; other = mNextAgents[other])
+        {
+            if (other > agent && mLastCells[other] == cell)
+            {
+                meetings.emplace_back(agent, other);
+            }
+        }
+    }
+}
+
+void Fairyland::moveAgents(const Direction* directions)
+{
+    const std::size_t count = mAgentX.size();
+    if (mLogging)
+    {
+        for (std::size_t agent = 0; agent < count; ++agent)
+        {
+            mOutput << static_cast<char>(directions[agent]);
+        }
+        check(mOutput.good(), "Cannot write to file output.txt");
+    }
+    if (mLog != nullptr)
+    {
+        for (std::size_t agent = 0; agent < count; ++agent)
+        {
+            mLog->push_back(static_cast<char>(directions[agent]));
+        }
+    }
 
     mTurnCount += 1;
     check(mTurnCount < 1000000, "Too many turns");
 
-    const Position lastIvanPos = mIvanPos;
-    const Position lastElenaPos = mElenaPos;
-
-    move(mIvanPos, directionIvan);
-    move(mElenaPos, directionElena);
+    for (std::size_t agent = 0; agent < count; ++agent)
+    {
+        Position position(mAgentX[agent], mAgentY[agent]);
+        move(position, directions[agent]);
+        mAgentX[agent] = position.first;
+        mAgentY[agent] = position.second;
+    }
+}
 
-    return mIvanPos == mElenaPos || lastIvanPos == mElenaPos && lastElenaPos == mIvanPos;
-}
\ No newline at end of file
+void Fairyland::sense(std::vector<unsigned char>& masks) const
+{
+    masks.resize(mAgentX.size());
+    for (std::size_t agent = 0; agent < masks.size(); ++agent)
+    {
+        masks[agent] = getOpenMask(agent);
+    }
+}
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <cstddef>
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -20,28 +25,95 @@ enum class Direction : char
     Right = 'R',
 };
 
+/// The labyrinth itself which never changes after loading, so one maze can be shared by many worlds and threads
+class Maze
+{
+public:
+    /// Loads the labyrinth: any rectangle of rows with the same width which ends with an empty line or the file end
+    explicit Maze(std::istream& input);
+
+public:
+    std::size_t getWidth() const;
+    std::size_t getHeight() const;
+    /// Returns the open directions of the cell as bits: 0 - Left, 1 - Right, 2 - Up, 3 - Down
+    unsigned char getOpenMask(int x, int y) const;
+    /// Returns start positions of Ivan, Elena and every '*' in row-major order
+    const std::vector<std::pair<int, int>>& getStarts() const;
+    bool isPassage(int x, int y) const;
+
+private:
+    std::size_t mWidth;
+    std::size_t mHeight;
+    std::vector<bool> mPassages;
+    std::vector<unsigned char> mMasks;
+    std::vector<std::pair<int, int>> mStarts;
+};
+
 class Fairyland
 {
     using Position = std::pair<int, int>;
+    friend class Maze;
 
 public:
     explicit Fairyland();
+    /// Loads the labyrinth from the stream. Such world doesn't write moves to output.txt
+    explicit Fairyland(std::istream& input);
+    /// Creates the world in the shared maze with agents at their start positions. Such world doesn't write
+    /// moves to output.txt
+    explicit Fairyland(std::shared_ptr<const Maze> maze);
+    /// Same as above but Ivan and Elena start at the given positions
+    Fairyland(std::shared_ptr<const Maze> maze, std::pair<int, int> ivanPos, std::pair<int, int> elenaPos);
     ~Fairyland();
 
 public:
     int getTurnCount() const;
+    std::size_t getWidth() const;
+    std::size_t getHeight() const;
+    std::shared_ptr<const Maze> getMaze() const;
     bool canGo(Character name, Direction direction) const;
+    /// Returns the open directions of the character cell as bits: 0 - Left, 1 - Right, 2 - Up, 3 - Down
+    unsigned char getOpenMask(Character name) const;
+    unsigned char getOpenMask(int x, int y) const;
+    unsigned char getOpenMask(std::size_t agent) const;
+    std::pair<int, int> getPosition(Character name) const;
+    std::pair<int, int> getPosition(std::size_t agent) const;
+    /// Agents are Ivan (0), Elena (1) and others which are marked by '*' in row-major order or added by addAgent
+    std::size_t getAgentCount() const;
+    std::size_t addAgent(int x, int y);
+    bool isPassage(int x, int y) const;
     bool go(Direction directionIvan, Direction directionElena);
+    /// Moves all agents at once in one turn. Agents which met each other (share the cell or passed through each
+    /// other) are written as pairs of indexes where the first is less
+    void goAgents(const std::vector<Direction>& directions, std::vector<std::pair<std::size_t, std::size_t>>& meetings);
+    /// Writes open directions of every agent cell, see getOpenMask
+    void sense(std::vector<unsigned char>& masks) const;
+    /// Returns the size of moves written to output.txt or 0 when the world doesn't write moves
+    std::streamoff getLogOffset();
+    /// Appends moves of every next turn to the string in the same format as output.txt has. nullptr stops it
+    void setLog(std::string* log);
+    /// Puts characters where they were in the saved game and writes the saved move log of that game to output.txt
+    void restore(std::pair<int, int> ivanPos, std::pair<int, int> elenaPos, int turnCount, const std::string& log);
 
 private:
     static void check(bool expression, const char* message);
-    static bool move(Position& position, Direction direction);
+    static std::shared_ptr<const Maze> loadInput();
+    bool move(Position& position, Direction direction) const;
+    void moveAgents(const Direction* directions);
+    std::size_t getCell(std::size_t agent) const;
+    static unsigned char bit(Direction direction);
 
 private:
-    static const std::size_t gSize = 10;
-    std::vector<std::vector<bool>> mMaze;
-    Position mIvanPos;
-    Position mElenaPos;
+    std::shared_ptr<const Maze> mMaze;
+    // Agents are kept as separate arrays which are walked by batch moves
+    std::vector<int> mAgentX;
+    std::vector<int> mAgentY;
+    std::vector<std::size_t> mLastCells;
+    // Spatial hash: the first agent in the cell and the next agent in the same cell
+    std::unordered_map<std::size_t, std::size_t> mCellAgents;
+    std::vector<std::size_t> mNextAgents;
+    std::vector<Direction> mDirections;
     std::ofstream mOutput;
+    std::string* mLog;
+    bool mLogging;
     int mTurnCount;
 };
@@ -0,0 +1,228 @@
+#include "bitboard.hpp"
+#include "fairy_tail.hpp"
+#include "game.hpp"
+#include "graph.hpp"
+#include "memory.hpp"
+#include "pathfinder.hpp"
+
+namespace game {
+    namespace {
+        /// Plays the whole game like game::play with the arena does
+        ///
+        /// @param bounds False when the bounds check must be disabled
+        /// @param budget Limit of every search of pals
+        /// @param tiered True when graphs compact cold blocks
+        /// @param partner Partner of Elena's searches or nullptr
+        Result playBounded(
+            const std::shared_ptr<Fairyland>& world,
+            memory::Arena& arena,
+            const bool bounds,
+            const graph::Budget& budget,
+            const bool tiered,
+            Partner* partner)
+        {
+            // The classic labyrinth fits the bitboard engine which gives the same advices much faster
+            if (bitboard::Pal<10, 10>::fits(world->getWidth(), world->getHeight())) {
+                auto ivan = bitboard::Pal<10, 10>();
+                auto elena = bitboard::Pal<10, 10>();
+                return play(*world, ivan, elena, bounds, budget);
+            }
+
+            // The ledger of the run is not shared with the partner thread, so accounted runs stay on one thread
+            if (memory::gLedger != nullptr) {
+                partner = nullptr;
+            }
+
+            auto result = Result(Verdict::AlgorithmError, 0, std::string());
+            {
+                // The arena releases nothing before the reset, so tiered graphs keep their nodes in the global heap
+                // where compacted nodes are released at once. Graphs must be destroyed before the arena is reset
+                const auto graph_arena = tiered ? nullptr : &arena;
+                const auto ivan_g = std::allocate_shared<graph::Graph>(
+                    memory::ArenaAllocator<graph::Graph>(graph_arena),
+                    graph::Graph::makeNode(graph_arena, true),
+                    graph_arena);
+                ivan_g->setTiering(tiered);
+                auto ivan_p = pathfinder::Pathfinder(world, Character::Ivan, ivan_g);
+
+                // Elena's searches may run on the partner thread, so her graph never takes memory of Ivan's arena
+                const auto elena_arena = tiered || partner == nullptr ? graph_arena : &partner->getArena();
+                const auto elena_g = std::allocate_shared<graph::Graph>(
+                    memory::ArenaAllocator<graph::Graph>(elena_arena),
+                    graph::Graph::makeNode(elena_arena, true),
+                    elena_arena);
+                elena_g->setTiering(tiered);
+                auto elena_p = pathfinder::Pathfinder(world, Character::Elena, elena_g);
+
+                result = play(*world, ivan_p, elena_p, bounds, budget, partner);
+            }
+            arena.reset();
+            if (partner != nullptr) {
+                partner->getArena().reset();
+            }
+            return result;
+        }
+    }
+
+    /* Turn */
+
+    Turn::Turn(const Direction t_ivan, const Direction t_elena) noexcept : ivan(t_ivan), elena(t_elena) {}
+
+    /* Result */
+
+    Result::Result(const Verdict t_verdict, const int t_turn_count, const std::string& t_message) noexcept
+        : verdict(t_verdict),
+        turn_count(t_turn_count),
+        message(t_message),
+        early(false),
+        saved_turns(0),
+        expansions(0),
+        nodes(0),
+        advices(0),
+        restores(0),
+        restore_time(0),
+        budget_hits(0)
+    {}
+
+    /* Partner */
+
+    Partner::Partner() : m_task(nullptr), m_context(nullptr), m_state(Idle)
+    {
+        m_thread = std::thread(&Partner::work, this);
+    }
+
+    Partner::~Partner()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_state.store(Stopped);
+        }
+        m_started.notify_one();
+        m_thread.join();
+    }
+
+    memory::Arena& Partner::getArena() noexcept
+    {
+        return m_arena;
+    }
+
+    void Partner::start(void (*task)(void*), void* context) noexcept
+    {
+        m_task = task;
+        m_context = context;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_state.store(Started);
+        }
+        m_started.notify_one();
+    }
+
+    void Partner::wait() noexcept
+    {
+        for (int spin = 0; spin < gSpins; ++spin) {
+            if (m_state.load(std::memory_order_acquire) == Idle) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_finished.wait(lock, [this]() { return m_state.load() == Idle; });
+    }
+
+    void Partner::work() noexcept
+    {
+        while (true) {
+            // The next task usually comes soon, since the pal advised in parallel has a large graph
+            auto state = m_state.load(std::memory_order_acquire);
+            for (int spin = 0; spin < gSpins && state == Idle; ++spin) {
+                std::this_thread::yield();
+                state = m_state.load(std::memory_order_acquire);
+            }
+            if (state == Idle) {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_started.wait(lock, [this]() { return m_state.load() != Idle; });
+                state = m_state.load();
+            }
+            if (state == Stopped) {
+                return;
+            }
+
+            m_task(m_context);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_state.store(Idle);
+            }
+            m_finished.notify_one();
+        }
+    }
+
+    /* Functions */
+
+    Result play(const std::shared_ptr<Fairyland>& world)
+    {
+        memory::Arena arena;
+        return play(world, arena);
+    }
+
+    Result play(
+        const std::shared_ptr<Fairyland>& world,
+        memory::Arena& arena,
+        const graph::Budget& budget,
+        const bool tiered,
+        Partner* partner)
+    {
+        return playBounded(world, arena, true, budget, tiered, partner);
+    }
+
+    Result measure(
+        const std::shared_ptr<Fairyland>& world,
+        memory::Arena& arena,
+        const graph::Budget& budget,
+        const bool tiered,
+        Partner* partner)
+    {
+        const auto ivan = world->getPosition(Character::Ivan);
+        const auto elena = world->getPosition(Character::Elena);
+        auto result = playBounded(world, arena, true, budget, tiered, partner);
+        if (result.early) {
+            const auto replay = std::make_shared<Fairyland>(world->getMaze(), ivan, elena);
+            const auto replayed = playBounded(replay, arena, false, budget, tiered, partner);
+            result.saved_turns = replayed.turn_count - result.turn_count;
+        }
+        return result;
+    }
+
+    const char* getVerdictName(const Verdict verdict) noexcept
+    {
+        switch (verdict) {
+            case Verdict::Met:
+                return "met";
+            case Verdict::CannotMeet:
+                return "cannot-meet";
+            default:
+                return "error";
+        }
+    }
+
+    void report(std::ostream& output, const Result& result)
+    {
+        switch (result.verdict) {
+            case Verdict::Met:
+                output << "Ivan and Elena had meet!" << std::endl;
+                output << "Turn count: " << result.turn_count << std::endl;
+                if (result.map.empty()) {
+                    output << "Restore map error: This algorithm cannot restore map for this case" << std::endl;
+                    return;
+                }
+                output << std::endl << result.map << std::endl;
+                return;
+            case Verdict::CannotMeet:
+                output << "Ivan and Elena cannot meet!" << std::endl;
+                output << "Turn count: " << result.turn_count << std::endl;
+                return;
+            default:
+                output << result.message << std::endl;
+                return;
+        }
+    }
+}
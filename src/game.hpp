@@ -0,0 +1,863 @@
+#pragma once
+
+#include "binary.hpp"
+#include "fairy_tail.hpp"
+#include "graph.hpp"
+#include "memory.hpp"
+#include "pathfinder.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace game {
+    /// Represents the final state of the game
+    enum class Verdict {
+        Met,             //!< Pals had met in the labyrinth
+        CannotMeet,      //!< Pals are in the unlinked parts of the labyrinth
+        AlgorithmError,  //!< Pathfinders gave inconsistent advices
+    };
+
+    /// Represents one turn of the game in the world directions. A pal who must stay uses Direction::Pass
+    struct Turn {
+        Direction ivan;   //!< Ivan's direction in the world
+        Direction elena;  //!< Elena's direction in the world
+
+        Turn(const Direction t_ivan, const Direction t_elena) noexcept;
+    };
+
+    /// Represents the game result which is reported to the user
+    struct Result {
+        Verdict verdict;      //!< How the game ended
+        int turn_count;       //!< Turn count of the world at the end of the game
+        std::string message;  //!< Error message when verdict is AlgorithmError otherwise empty
+        std::string map;      //!< Restored map when pals had met. Empty when it cannot be restored
+        bool early;           //!< True when CannotMeet was proven from bounds of graphs (see Match::isEarly)
+        int saved_turns;      //!< Turns saved by the early verdict. Counted only by game::measure, otherwise 0
+        std::uint64_t expansions;  //!< Nodes expanded by searches of both pals (see Match::getExpansions)
+        std::size_t nodes;    //!< Nodes of both graphs at the end of the game
+        int advices;          //!< Advices given to both pals (see Match::getAdviceCount)
+        int restores;         //!< Attempts to restore the map (see Match::getRestoreCount)
+        double restore_time;  //!< Seconds spent to restore the map
+        std::uint64_t budget_hits;  //!< Searches of both pals paused by the budget (see Match::getBudgetHits)
+
+        Result(const Verdict t_verdict, const int t_turn_count, const std::string& t_message) noexcept;
+    };
+
+    /// Represents the persistent thread which runs one task while the caller runs another one, so searches of
+    /// both pals take two cores without a thread per turn. Threads meet at the barrier which spins for a while
+    /// before it sleeps, so short tasks don't wait for the scheduler
+    class Partner {
+    public:
+        Partner();
+        Partner(const Partner&) = delete;
+        Partner& operator = (const Partner&) = delete;
+
+        /// Waits until the thread is over. No task must be started and not waited
+        ~Partner();
+
+    public:
+        /// @returns Arena of the pal whose searches are run by the partner. It is never used by two threads at
+        /// once, since the caller waits for the task before it touches the pal again
+        memory::Arena& getArena() noexcept;
+
+        /// Starts the task on the partner thread. Partner::wait must be called before the next start
+        void start(void (*task)(void*), void* context) noexcept;
+
+        /// Waits until the started task is over. Everything written by the task is visible after it
+        void wait() noexcept;
+
+    private:
+        /// Runs tasks until the partner is destroyed
+        void work() noexcept;
+
+    private:
+        /// State of the barrier
+        enum State {
+            Idle,     //!< No task is running
+            Started,  //!< Task is given to the partner thread
+            Stopped,  //!< Partner thread must be over
+        };
+
+        static const int gSpins = 256;  //!< Checks of the state before the thread sleeps
+
+        memory::Arena m_arena;
+        void (*m_task)(void*);
+        void* m_context;
+        std::atomic<int> m_state;
+        std::mutex m_mutex;
+        std::condition_variable m_started;
+        std::condition_variable m_finished;
+        std::thread m_thread;
+    };
+
+    /// Steps the game of two pals turn by turn. Each turn is given by Match::next, applied to the world by the
+    /// caller and committed back by Match::commit, so one world can be replaced by any other world representation.
+    ///
+    /// Pal is any type with the Pathfinder interface: getAdvice, deadendCheck, go(direction, mask), updateNode(mask),
+    /// getBudgetHits, getExpansions, getFingerprint, getNodeCount, getRectangle, isAlignable, isExplored, rerun,
+    /// restoreMap, setBounds and setBudget.
+    template <typename Pal>
+    class Match {
+    public:
+        /// @param t_ivan Ivan's pal with the initialized start node
+        /// @param t_elena Elena's pal with the initialized start node
+        /// @param ivan_mask Open directions of Ivan's start cell
+        /// @param elena_mask Open directions of Elena's start cell
+        /// @param t_width Width of the labyrinth
+        /// @param t_height Height of the labyrinth
+        Match(
+            Pal& t_ivan,
+            Pal& t_elena,
+            const unsigned char ivan_mask,
+            const unsigned char elena_mask,
+            const int t_width,
+            const int t_height) noexcept;
+
+        /// Resumes the match written by Match::save. Pals are loaded from the same data, so they must be created
+        /// the same way as the saved ones
+        ///
+        /// @throws std::runtime_error when data is corrupted
+        Match(Pal& t_ivan, Pal& t_elena, const int t_width, const int t_height, std::istream& input);
+
+    public:
+        /// Gives the next turn according to pals advices
+        ///
+        /// @returns False when the game is over. In that case the turn is not changed
+        bool next(Turn& turn) noexcept;
+
+        /// Applies the turn given by Match::next to pals. Must be used after the turn was applied to the world
+        ///
+        /// @param meeting True if pals had met in the world at this turn
+        /// @param ivan_mask Open directions of Ivan's cell after the turn
+        /// @param elena_mask Open directions of Elena's cell after the turn
+        void commit(const bool meeting, const unsigned char ivan_mask, const unsigned char elena_mask) noexcept;
+
+        /// @returns Amount of advices which were given to both pals
+        int getAdviceCount() const noexcept;
+
+        /// @returns Amount of searches of both pals which were paused by the budget (see Match::setBudget)
+        std::uint64_t getBudgetHits() const noexcept;
+
+        /// @returns Amount of nodes which were expanded by searches of both pals for unvisited nodes
+        std::uint64_t getExpansions() const noexcept;
+
+        /// @returns Error message when the verdict is AlgorithmError otherwise empty string
+        const std::string& getMessage() const noexcept;
+
+        /// @returns Node count of both pals
+        std::size_t getNodeCount() const noexcept;
+
+        /// @returns Amount of attempts to restore the map by Match::restoreMap
+        int getRestoreCount() const noexcept;
+
+        /// @returns Verdict of the game. Makes sense only when the game is over
+        Verdict getVerdict() const noexcept;
+
+        /// @returns True when the game was finished by the proof that known graphs of pals cannot lay in one part
+        /// of the labyrinth (see Match::isApart)
+        bool isEarly() const noexcept;
+
+        /// @returns True when the game is over
+        bool isOver() const noexcept;
+
+        /// @returns True when the next turn starts with new advices. Only such match can be saved
+        bool isAdvising() const noexcept;
+
+        /// Restores the map using both pals. Firstly tries relative to Ivan and then relative to Elena
+        ///
+        /// @returns Map of the labyrinth or empty string
+        std::string restoreMap(const int width, const int height) noexcept;
+
+        /// Enables or disables the proof of Match::isApart. It is enabled by default, so disabled one only shows
+        /// how long the game would be without it
+        void setBoundsCheck(const bool enabled) noexcept;
+
+        /// Limits every search of both pals for unvisited nodes, so no advice takes longer than the budget. A pal
+        /// whose search is over the budget stays for the turn while another one makes one step, and both are
+        /// advised again after it. The search of the staying pal is resumed, so the game takes more turns but
+        /// every turn is given in time. Pals are not limited by default
+        void setBudget(const graph::Budget& budget) noexcept;
+
+        /// Gives Elena's advices on the partner thread while Ivan's ones are given on the calling thread. Pals must
+        /// share no memory, so Elena's pal must keep its memory in the partner's arena. Advices are the same as
+        /// without the partner. Small graphs are advised on the calling thread, since their searches are shorter
+        /// than the barrier. nullptr disables it
+        void setPartner(Partner* partner) noexcept;
+
+        /// Writes the phase and both pals. Pal must have save(std::ostream&) and load(std::istream&) methods.
+        /// Must be used only when Match::isAdvising is true
+        void save(std::ostream& output) const;
+
+    private:
+        /// Represents the current step of the main algorithm. Advise and Rerun are written by Match::save, so their
+        /// values must not change
+        enum class Phase {
+            Advise,     //!< Both pals need new advices
+            Both,       //!< Both pals are moving
+            Ivan,       //!< Only Ivan is moving while Elena waits
+            Elena,      //!< Only Elena is moving while Ivan waits
+            Rerun,      //!< Ivan reruns the labyrinth and needs new advice
+            RerunMove,  //!< Ivan reruns the labyrinth and moves
+            Wait,       //!< Both pals wait while their searches are resumed
+            RerunWait,  //!< Ivan reruns the labyrinth and waits while his search is resumed
+            Over,       //!< The game is over
+        };
+
+        /// Gets advices of both pals and chooses the next phase
+        void advise() noexcept;
+
+        /// Gets Elena's advice. Task of Partner::start
+        static void adviseElena(void* match) noexcept;
+
+        /// Gets Ivan's rerun advice and chooses the next phase
+        void adviseRerun() noexcept;
+
+        /// Checks if known graphs prove that pals are in different parts of the labyrinth. A pal who has explored
+        /// knows the whole part, so the graph of another pal must fit in it by node count and rectangle. Otherwise
+        /// both graphs lay in one width x height labyrinth, so large rectangles allow only few offsets between
+        /// them. Pals are apart when every such offset puts a passage of one graph on a wall of another or both
+        /// pals in one cell. Offsets are checked only when there are no more than gMaxOffsets of them and
+        /// the offset which was found the last time is checked first
+        bool isApart() noexcept;
+
+        /// Finishes the game with the given verdict
+        void finish(const Verdict verdict, const std::string& message = std::string()) noexcept;
+
+    private:
+        static const int gMaxOffsets = 64;
+        static const size_t gPartnerNodes = 1024;  //!< Node count of both pals since which the partner is used
+
+        Pal& m_ivan;
+        Pal& m_elena;
+        pathfinder::Advice m_ivan_a;
+        pathfinder::Advice m_elena_a;
+        Phase m_phase;
+        size_t m_index;     //!< Index of the current route step
+        size_t m_distance;  //!< Amount of steps in the current phase
+        int m_advices;      //!< Amount of advices given to both pals
+        int m_restores;     //!< Amount of attempts to restore the map
+        Verdict m_verdict;
+        std::string m_message;
+        int m_width;
+        int m_height;
+        bool m_bounds;  //!< True when Match::isApart is used
+        bool m_early;   //!< True when the game was finished by Match::isApart
+        graph::Position m_witness;  //!< Shift between frames of pals which Match::isApart found the last time
+        Partner* m_partner;
+    };
+
+    /// Plays the whole game in the world using Match
+    ///
+    /// @returns Result of the game with restored map when pals had met
+    template <typename Pal>
+    Result play(Fairyland& world, Pal& ivan, Pal& elena);
+
+    /// Plays the whole game like game::play with the bounds check which can be disabled (see Match::setBoundsCheck),
+    /// the budget of searches (see Match::setBudget) and the partner of Elena's searches (see Match::setPartner)
+    template <typename Pal>
+    Result play(
+        Fairyland& world,
+        Pal& ivan,
+        Pal& elena,
+        const bool bounds,
+        const graph::Budget& budget,
+        Partner* partner = nullptr);
+
+    /// Plays the already started match in the world
+    ///
+    /// @param on_turn Function which is called with the match before every turn
+    template <typename Pal, typename OnTurn>
+    Result play(Fairyland& world, Match<Pal>& match, const OnTurn& on_turn);
+
+    /// @returns Result of the match which is over in the world. The map is restored when pals had met
+    template <typename Pal>
+    Result conclude(Fairyland& world, Match<Pal>& match);
+
+    /// @returns Result of the match which is over after the turn count in the width x height labyrinth. Used by
+    /// engines which don't keep Fairyland
+    template <typename Pal>
+    Result conclude(Match<Pal>& match, const int turn_count, const int width, const int height);
+
+    /// Plays the whole game in the world. Bitboard engine is selected automatically when the labyrinth fits
+    /// it, otherwise graph::Graph with pathfinder::Pathfinder are used
+    Result play(const std::shared_ptr<Fairyland>& world);
+
+    /// Plays the whole game like the function above but keeps all solver memory in the arena. The arena is reset
+    /// when the game is over, so one arena could be reused by many games without calls to the global heap
+    ///
+    /// @param budget Limit of every search of pals (see Match::setBudget). Unlimited by default
+    /// @param tiered True when graphs keep cold blocks as tiles (see graph::Graph::setTiering). Tiered graphs are
+    /// kept in the global heap, so their memory follows the frontier. The bitboard engine is never tiered
+    /// @param partner Partner which gives Elena's advices of graphs in parallel (see Match::setPartner). Its arena
+    /// keeps Elena's graph and is reset with the arena. Runs whose memory is accounted and the bitboard engine
+    /// don't use it
+    Result play(
+        const std::shared_ptr<Fairyland>& world,
+        memory::Arena& arena,
+        const graph::Budget& budget = graph::Budget(),
+        const bool tiered = false,
+        Partner* partner = nullptr);
+
+    /// Plays the whole game like game::play does and, when the game was finished early, plays it once more from
+    /// the start positions without the bounds check to count saved turns
+    Result measure(
+        const std::shared_ptr<Fairyland>& world,
+        memory::Arena& arena,
+        const graph::Budget& budget = graph::Budget(),
+        const bool tiered = false,
+        Partner* partner = nullptr);
+
+    /// Writes the result in the same format as the program always did
+    void report(std::ostream& output, const Result& result);
+
+    /// @returns Short name of the verdict which is used by batch tools: met, cannot-meet or error
+    const char* getVerdictName(const Verdict verdict) noexcept;
+
+    /* Match */
+
+    template <typename Pal>
+    Match<Pal>::Match(
+        Pal& t_ivan,
+        Pal& t_elena,
+        const unsigned char ivan_mask,
+        const unsigned char elena_mask,
+        const int t_width,
+        const int t_height) noexcept
+        : m_ivan(t_ivan),
+        m_elena(t_elena),
+        m_ivan_a(pathfinder::AdviceType::Rendezvous),
+        m_elena_a(pathfinder::AdviceType::Rendezvous),
+        m_phase(Phase::Advise),
+        m_index(0),
+        m_distance(0),
+        m_advices(0),
+        m_restores(0),
+        m_verdict(Verdict::AlgorithmError),
+        m_width(t_width),
+        m_height(t_height),
+        m_bounds(true),
+        m_early(false),
+        m_witness(0, 0),
+        m_partner(nullptr)
+    {
+        memory::setPhase(memory::Phase::Explore);
+        m_ivan.setBounds(t_width, t_height);
+        m_elena.setBounds(t_width, t_height);
+
+        m_ivan.updateNode(ivan_mask);
+        m_ivan.deadendCheck();
+
+        m_elena.updateNode(elena_mask);
+        m_elena.deadendCheck();
+    }
+
+    template <typename Pal>
+    Match<Pal>::Match(Pal& t_ivan, Pal& t_elena, const int t_width, const int t_height, std::istream& input)
+        : m_ivan(t_ivan),
+        m_elena(t_elena),
+        m_ivan_a(pathfinder::AdviceType::Rendezvous),
+        m_elena_a(pathfinder::AdviceType::Rendezvous),
+        m_phase(Phase::Advise),
+        m_index(0),
+        m_distance(0),
+        m_advices(0),
+        m_restores(0),
+        m_verdict(Verdict::AlgorithmError),
+        m_width(t_width),
+        m_height(t_height),
+        m_bounds(true),
+        m_early(false),
+        m_witness(0, 0),
+        m_partner(nullptr)
+    {
+        const auto phase = static_cast<Phase>(binary::read<std::uint8_t>(input));
+        if (phase != Phase::Advise && phase != Phase::Rerun) {
+            throw std::runtime_error("Corrupted match data");
+        }
+        m_phase = phase;
+        memory::setPhase(phase == Phase::Rerun ? memory::Phase::Rerun : memory::Phase::Explore);
+        m_ivan.load(input);
+        m_elena.load(input);
+
+        // Ivan who reruns the labyrinth must visit every node
+        if (phase != Phase::Rerun) {
+            m_ivan.setBounds(t_width, t_height);
+        }
+        m_elena.setBounds(t_width, t_height);
+    }
+
+    template <typename Pal>
+    bool Match<Pal>::next(Turn& turn) noexcept
+    {
+        while (true) {
+            switch (m_phase) {
+                case Phase::Advise:
+                    advise();
+                    break;
+                case Phase::Rerun:
+                    adviseRerun();
+                    break;
+                case Phase::Both:
+                    if (m_index < m_distance) {
+                        turn = Turn(m_ivan_a.route[m_index].world, m_elena_a.route[m_index].world);
+                        return true;
+                    }
+                    m_phase = Phase::Advise;
+                    break;
+                case Phase::Ivan:
+                    if (m_index < m_distance) {
+                        turn = Turn(m_ivan_a.route[m_index].world, Direction::Pass);
+                        return true;
+                    }
+                    m_phase = Phase::Advise;
+                    break;
+                case Phase::Elena:
+                    if (m_index < m_distance) {
+                        turn = Turn(Direction::Pass, m_elena_a.route[m_index].world);
+                        return true;
+                    }
+                    m_phase = Phase::Advise;
+                    break;
+                case Phase::RerunMove:
+                    if (m_index < m_distance) {
+                        turn = Turn(m_ivan_a.route[m_index].world, Direction::Pass);
+                        return true;
+                    }
+                    // Possible everlasting cycle when algorithm is broken
+                    // and give move advice even when all nodes are visited
+                    m_phase = Phase::Rerun;
+                    break;
+                case Phase::Wait:
+                    if (m_index < m_distance) {
+                        turn = Turn(Direction::Pass, Direction::Pass);
+                        return true;
+                    }
+                    m_phase = Phase::Advise;
+                    break;
+                case Phase::RerunWait:
+                    if (m_index < m_distance) {
+                        turn = Turn(Direction::Pass, Direction::Pass);
+                        return true;
+                    }
+                    m_phase = Phase::Rerun;
+                    break;
+                default:
+                    return false;
+            }
+        }
+    }
+
+    template <typename Pal>
+    void Match<Pal>::commit(const bool meeting, const unsigned char ivan_mask, const unsigned char elena_mask) noexcept
+    {
+        switch (m_phase) {
+            case Phase::Both:
+                m_ivan.go(m_ivan_a.route[m_index].graph, ivan_mask);
+                m_elena.go(m_elena_a.route[m_index].graph, elena_mask);
+                break;
+            case Phase::Ivan:
+            case Phase::RerunMove:
+                m_ivan.go(m_ivan_a.route[m_index].graph, ivan_mask);
+                break;
+            case Phase::Elena:
+                m_elena.go(m_elena_a.route[m_index].graph, elena_mask);
+                break;
+            case Phase::Wait:
+            case Phase::RerunWait:
+                break;
+            default:
+                return;
+        }
+        m_index += 1;
+
+        if (meeting) {
+            finish(Verdict::Met);
+        }
+    }
+
+    template <typename Pal>
+    int Match<Pal>::getAdviceCount() const noexcept
+    {
+        return m_advices;
+    }
+
+    template <typename Pal>
+    std::uint64_t Match<Pal>::getBudgetHits() const noexcept
+    {
+        return m_ivan.getBudgetHits() + m_elena.getBudgetHits();
+    }
+
+    template <typename Pal>
+    std::uint64_t Match<Pal>::getExpansions() const noexcept
+    {
+        return m_ivan.getExpansions() + m_elena.getExpansions();
+    }
+
+    template <typename Pal>
+    const std::string& Match<Pal>::getMessage() const noexcept
+    {
+        return m_message;
+    }
+
+    template <typename Pal>
+    std::size_t Match<Pal>::getNodeCount() const noexcept
+    {
+        return m_ivan.getNodeCount() + m_elena.getNodeCount();
+    }
+
+    template <typename Pal>
+    int Match<Pal>::getRestoreCount() const noexcept
+    {
+        return m_restores;
+    }
+
+    template <typename Pal>
+    Verdict Match<Pal>::getVerdict() const noexcept
+    {
+        return m_verdict;
+    }
+
+    template <typename Pal>
+    bool Match<Pal>::isEarly() const noexcept
+    {
+        return m_early;
+    }
+
+    template <typename Pal>
+    bool Match<Pal>::isOver() const noexcept
+    {
+        return m_phase == Phase::Over;
+    }
+
+    template <typename Pal>
+    bool Match<Pal>::isAdvising() const noexcept
+    {
+        switch (m_phase) {
+            case Phase::Advise:
+            case Phase::Rerun:
+                return true;
+            case Phase::Over:
+                return false;
+            default:
+                // Route is over, so Match::next asks for advices at once
+                return m_index >= m_distance;
+        }
+    }
+
+    template <typename Pal>
+    std::string Match<Pal>::restoreMap(const int width, const int height) noexcept
+    {
+        // Restoring map is relative operation, so some maps could be lost relative to Ivan.
+        // These variants are taken relative to Elena
+        m_restores += 1;
+        auto sheet = m_ivan.restoreMap(m_elena, '@', '&', width, height);
+        if (sheet.empty()) {
+            m_restores += 1;
+            sheet = m_elena.restoreMap(m_ivan, '&', '@', width, height);
+        }
+        return sheet;
+    }
+
+    template <typename Pal>
+    void Match<Pal>::setBoundsCheck(const bool enabled) noexcept
+    {
+        m_bounds = enabled;
+    }
+
+    template <typename Pal>
+    void Match<Pal>::setBudget(const graph::Budget& budget) noexcept
+    {
+        m_ivan.setBudget(budget);
+        m_elena.setBudget(budget);
+    }
+
+    template <typename Pal>
+    void Match<Pal>::setPartner(Partner* partner) noexcept
+    {
+        m_partner = partner;
+    }
+
+    template <typename Pal>
+    void Match<Pal>::save(std::ostream& output) const
+    {
+        const auto phase = m_phase == Phase::Rerun || m_phase == Phase::RerunMove || m_phase == Phase::RerunWait
+            ? Phase::Rerun
+            : Phase::Advise;
+        binary::write<std::uint8_t>(output, static_cast<std::uint8_t>(phase));
+        m_ivan.save(output);
+        m_elena.save(output);
+    }
+
+    template <typename Pal>
+    void Match<Pal>::advise() noexcept
+    {
+        if (m_bounds && isApart()) {
+            m_early = true;
+            finish(Verdict::CannotMeet);
+            return;
+        }
+
+        if (m_partner != nullptr && getNodeCount() >= gPartnerNodes) {
+            m_partner->start(&Match::adviseElena, this);
+            m_ivan_a = m_ivan.getAdvice();
+            m_partner->wait();
+        }
+        else {
+            m_ivan_a = m_ivan.getAdvice();
+            m_elena_a = m_elena.getAdvice();
+        }
+        m_advices += 2;
+        m_index = 0;
+
+        // Pal whose search is over the budget stays for one turn while another one makes one step of its route.
+        // Both are advised again after the turn, so the pal who waits is never left behind for the whole route
+        if (m_ivan_a.type == pathfinder::AdviceType::Wait || m_elena_a.type == pathfinder::AdviceType::Wait) {
+            m_distance = 1;
+            if (m_ivan_a.type == pathfinder::AdviceType::Move) {
+                m_phase = Phase::Ivan;
+            }
+            else if (m_elena_a.type == pathfinder::AdviceType::Move) {
+                m_phase = Phase::Elena;
+            }
+            else {
+                m_phase = Phase::Wait;
+            }
+            return;
+        }
+
+        if (m_ivan_a.type == pathfinder::AdviceType::Move) {
+            if (m_elena_a.type == pathfinder::AdviceType::Move) {
+                // Both must go until met or somebody reach spot
+                // In second case this person needs new advice
+                const auto ivan_d = m_ivan_a.route.size();
+                const auto elena_d = m_elena_a.route.size();
+                m_distance = ivan_d < elena_d ? ivan_d : elena_d;
+                m_phase = Phase::Both;
+            }
+            else /* m_elena_a.type == pathfinder::AdviceType::Rendezvous */ {
+                // Rendezvous appears only if one of them is done with the explore
+                if (m_elena.getNodeCount() < m_ivan.getNodeCount() && m_elena.isExplored()) {
+                    finish(Verdict::CannotMeet);
+                    return;
+                }
+                m_distance = m_ivan_a.route.size();
+                m_phase = Phase::Ivan;
+            }
+        }
+        else /* m_ivan_a.type == pathfinder::AdviceType::Rendezvous */ {
+            // Same as previous but relative to Elena
+            if (m_elena_a.type == pathfinder::AdviceType::Move) {
+                if (m_ivan.getNodeCount() < m_elena.getNodeCount() && m_ivan.isExplored()) {
+                    finish(Verdict::CannotMeet);
+                    return;
+                }
+                m_distance = m_elena_a.route.size();
+                m_phase = Phase::Elena;
+            }
+            else /* m_elena_a.type == pathfinder::AdviceType::Rendezvous */ {
+                // That case is the most interesting because if labyrinths have the same node count
+                // then we need to check topologic and then try to concat graphs
+                if (!m_ivan.isExplored() || !m_elena.isExplored()) {
+                    finish(
+                        Verdict::AlgorithmError,
+                        "Algorithm error: labyrinth are not explored but both pals got a Rendezvous advice");
+                    return;
+                }
+
+                if (m_ivan.getNodeCount() != m_elena.getNodeCount()) {
+                    finish(Verdict::CannotMeet);
+                    return;
+                }
+
+                // Explored graphs of the same part are equal up to translation, so different shapes
+                // mean different parts. Hashes may only collide, which costs the rerun below
+                if (m_ivan.getFingerprint() != m_elena.getFingerprint()) {
+                    finish(Verdict::CannotMeet);
+                    return;
+                }
+
+                // Only twin parts of the same shape are left. Is more effective to visit all nodes
+                // again then do something else (linking graphs, counting coordinates and extra checks)
+                m_ivan.rerun();
+                m_phase = Phase::Rerun;
+                memory::setPhase(memory::Phase::Rerun);
+            }
+        }
+    }
+
+    template <typename Pal>
+    void Match<Pal>::adviseElena(void* match) noexcept
+    {
+        auto& self = *static_cast<Match*>(match);
+        self.m_elena_a = self.m_elena.getAdvice();
+    }
+
+    template <typename Pal>
+    void Match<Pal>::adviseRerun() noexcept
+    {
+        m_ivan_a = m_ivan.getAdvice();
+        m_advices += 1;
+        m_index = 0;
+
+        if (m_ivan_a.type == pathfinder::AdviceType::Wait) {
+            m_distance = 1;
+            m_phase = Phase::RerunWait;
+            return;
+        }
+        if (m_ivan_a.type == pathfinder::AdviceType::Rendezvous) {
+            if (!m_ivan.isExplored()) {
+                finish(
+                    Verdict::AlgorithmError,
+                    "Algorithm error: labyrinth are not explored but Ivan got a Rendezvous advice");
+                return;
+            }
+            // For example, this could happen when the labyrinth have symmetric unlinked parts
+            finish(Verdict::CannotMeet);
+            return;
+        }
+        m_distance = m_ivan_a.route.size();
+        m_phase = Phase::RerunMove;
+    }
+
+    template <typename Pal>
+    bool Match<Pal>::isApart() noexcept
+    {
+        const auto ivan_r = m_ivan.getRectangle();
+        const auto elena_r = m_elena.getRectangle();
+        const auto ivan_w = ivan_r.max_x - ivan_r.min_x + 1;
+        const auto ivan_h = ivan_r.max_y - ivan_r.min_y + 1;
+        const auto elena_w = elena_r.max_x - elena_r.min_x + 1;
+        const auto elena_h = elena_r.max_y - elena_r.min_y + 1;
+
+        if (m_ivan.isExplored()
+            && (m_elena.getNodeCount() > m_ivan.getNodeCount() || elena_w > ivan_w || elena_h > ivan_h)) {
+            return true;
+        }
+        if (m_elena.isExplored()
+            && (m_ivan.getNodeCount() > m_elena.getNodeCount() || ivan_w > elena_w || ivan_h > elena_h)) {
+            return true;
+        }
+
+        // Offset is the position of Elena's rectangle relative to Ivan's one. Both rectangles must stay
+        // in the labyrinth, so it lays in [-(width - ivan_w); width - elena_w] and the same for y
+        const auto deltas = graph::Rectangle(
+            ivan_w - m_width,
+            ivan_h - m_height,
+            m_width - elena_w,
+            m_height - elena_h);
+        const auto columns = deltas.max_x - deltas.min_x + 1;
+        const auto rows = deltas.max_y - deltas.min_y + 1;
+        if (columns <= 0 || rows <= 0 || columns * rows > gMaxOffsets) {
+            return false;
+        }
+
+        // Graphs only grow, so the offset which is still possible usually stays possible for many moves
+        auto delta = graph::Position(
+            m_witness.x - ivan_r.min_x + elena_r.min_x,
+            m_witness.y - ivan_r.min_y + elena_r.min_y);
+        const auto witness = graph::Rectangle(delta.x, delta.y, delta.x, delta.y);
+        if (delta.x >= deltas.min_x && delta.x <= deltas.max_x
+            && delta.y >= deltas.min_y && delta.y <= deltas.max_y
+            && m_ivan.isAlignable(m_elena, witness, delta)) {
+            return false;
+        }
+
+        if (m_ivan.isAlignable(m_elena, deltas, delta)) {
+            m_witness = graph::Position(ivan_r.min_x + delta.x - elena_r.min_x, ivan_r.min_y + delta.y - elena_r.min_y);
+            return false;
+        }
+        return true;
+    }
+
+    template <typename Pal>
+    void Match<Pal>::finish(const Verdict verdict, const std::string& message) noexcept
+    {
+        m_verdict = verdict;
+        m_message = message;
+        m_phase = Phase::Over;
+    }
+
+    /* Functions */
+
+    template <typename Pal>
+    Result play(Fairyland& world, Pal& ivan, Pal& elena)
+    {
+        return play(world, ivan, elena, true, graph::Budget());
+    }
+
+    template <typename Pal>
+    Result play(
+        Fairyland& world,
+        Pal& ivan,
+        Pal& elena,
+        const bool bounds,
+        const graph::Budget& budget,
+        Partner* partner)
+    {
+        Match<Pal> match(
+            ivan,
+            elena,
+            world.getOpenMask(Character::Ivan),
+            world.getOpenMask(Character::Elena),
+            static_cast<int>(world.getWidth()),
+            static_cast<int>(world.getHeight()));
+        match.setBoundsCheck(bounds);
+        match.setBudget(budget);
+        match.setPartner(partner);
+        return play(world, match, [](const Match<Pal>&) {});
+    }
+
+    template <typename Pal, typename OnTurn>
+    Result play(Fairyland& world, Match<Pal>& match, const OnTurn& on_turn)
+    {
+        auto turn = Turn(Direction::Pass, Direction::Pass);
+        while (true) {
+            on_turn(match);
+            if (!match.next(turn)) {
+                break;
+            }
+            const auto meeting = world.go(turn.ivan, turn.elena);
+            match.commit(meeting, world.getOpenMask(Character::Ivan), world.getOpenMask(Character::Elena));
+        }
+        return conclude(world, match);
+    }
+
+    template <typename Pal>
+    Result conclude(Fairyland& world, Match<Pal>& match)
+    {
+        return conclude(
+            match,
+            world.getTurnCount(),
+            static_cast<int>(world.getWidth()),
+            static_cast<int>(world.getHeight()));
+    }
+
+    template <typename Pal>
+    Result conclude(Match<Pal>& match, const int turn_count, const int width, const int height)
+    {
+        auto result = Result(match.getVerdict(), turn_count, match.getMessage());
+        result.early = match.isEarly();
+        result.expansions = match.getExpansions();
+        result.nodes = match.getNodeCount();
+        result.advices = match.getAdviceCount();
+        result.budget_hits = match.getBudgetHits();
+        if (result.verdict == Verdict::Met) {
+            memory::setPhase(memory::Phase::Restore);
+            const auto begin = std::chrono::steady_clock::now();
+            result.map = match.restoreMap(width, height);
+            result.restore_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        }
+        result.restores = match.getRestoreCount();
+        return result;
+    }
+}
@@ -1,7 +1,15 @@
+#include "binary.hpp"
 #include "graph.hpp"
+#include "render.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <sstream>
 #include <stdexcept>
 #include <tuple>
+#include <unordered_set>
+#include <utility>
 
 namespace graph {
     /* Neighbor */
@@ -41,45 +49,186 @@ namespace graph {
         : min_x(t_min_x), min_y(t_min_y), max_x(t_max_x), max_y(t_max_y)
     {}
 
-    /* Tadpole */
+    /* Budget */
 
-    Tadpole::Tadpole(
-        const std::vector<Direction> t_route,
-        const std::vector<Position> t_nodes,
-        const std::weak_ptr<Node> t_head) noexcept
-        : route(t_route), nodes(t_nodes), head(t_head)
+    Budget::Budget() noexcept : Budget(0, 0) {}
+
+    Budget::Budget(const std::uint64_t t_expansions, const std::uint64_t t_microseconds) noexcept
+        : expansions(t_expansions), microseconds(t_microseconds)
     {}
 
-    std::vector<Tadpole> Tadpole::produceTadpole() const noexcept
+    bool Budget::isLimited() const noexcept
     {
-        std::vector<Tadpole> passages;
-        const auto pos = head.lock()->m_position;
-        for (const auto& neig : head.lock()->getNeighbors()) {
-            if (neig.node.expired()) {
-                continue;
+        return expansions != 0 || microseconds != 0;
+    }
+
+    /* Fingerprint */
+
+    namespace {
+        const std::uint64_t gFactorX = 0x9E3779B97F4A7C15ull;
+        const std::uint64_t gFactorY = 0xC2B2AE3D27D4EB4Full;
+
+        /// @returns Multiplicative inverse of the odd number modulo 2^64. Every Newton step doubles correct bits
+        std::uint64_t invert(const std::uint64_t number) noexcept
+        {
+            auto inverse = number;
+            for (int step = 0; step < 5; ++step) {
+                inverse *= 2 - number * inverse;
             }
+            return inverse;
+        }
 
-            bool visited = false;
-            for (const auto& node : nodes) {
-                if (neig.node.lock()->m_position == node) {
-                    visited = true;
-                    break;
+        /// @returns The base raised to the power modulo 2^64
+        std::uint64_t power(std::uint64_t base, std::uint64_t exponent) noexcept
+        {
+            std::uint64_t result = 1;
+            for (; exponent != 0; exponent >>= 1) {
+                if (exponent & 1) {
+                    result *= base;
                 }
+                base *= base;
             }
-            if (visited) {
-                continue;
+            return result;
+        }
+    }
+
+    Fingerprint::Fingerprint() noexcept : m_sum(0)
+    {}
+
+    void Fingerprint::add(const Position& pos) noexcept
+    {
+        m_sum += getFactor(pos.x, pos.y);
+    }
+
+    std::uint64_t Fingerprint::get(const Rectangle& rect) const noexcept
+    {
+        const auto width = static_cast<std::uint64_t>(static_cast<std::uint32_t>(rect.max_x - rect.min_x + 1));
+        const auto height = static_cast<std::uint64_t>(static_cast<std::uint32_t>(rect.max_y - rect.min_y + 1));
+        return (m_sum * getFactor(-rect.min_x, -rect.min_y)) ^ ((width << 32 | height) * 0xFF51AFD7ED558CCDull);
+    }
+
+    void Fingerprint::shift(const int delta_x, const int delta_y) noexcept
+    {
+        m_sum *= getFactor(delta_x, delta_y);
+    }
+
+    std::uint64_t Fingerprint::getFactor(const int x, const int y) noexcept
+    {
+        static const auto inverse_x = invert(gFactorX);
+        static const auto inverse_y = invert(gFactorY);
+
+        // Most positions lay near the start, so their factors are taken from the table
+        static const int near = 64;
+        static const auto table = []() {
+            std::array<std::uint64_t, 4 * near> factors;
+            for (int exponent = 0; exponent < near; ++exponent) {
+                factors[exponent] = power(gFactorX, exponent);
+                factors[near + exponent] = power(inverse_x, exponent);
+                factors[2 * near + exponent] = power(gFactorY, exponent);
+                factors[3 * near + exponent] = power(inverse_y, exponent);
+            }
+            return factors;
+        }();
+        if (x > -near && x < near && y > -near && y < near) {
+            return table[x < 0 ? near - x : x] * table[y < 0 ? 3 * near - y : 2 * near + y];
+        }
+
+        const auto factor_x = x < 0
+            ? power(inverse_x, static_cast<std::uint64_t>(-static_cast<std::int64_t>(x)))
+            : power(gFactorX, static_cast<std::uint64_t>(x));
+        const auto factor_y = y < 0
+            ? power(inverse_y, static_cast<std::uint64_t>(-static_cast<std::int64_t>(y)))
+            : power(gFactorY, static_cast<std::uint64_t>(y));
+        return factor_x * factor_y;
+    }
+
+    /* Route */
+
+    Route::Iterator::Iterator(const Route& t_route, const size_t t_index) noexcept
+        : m_route(&t_route), m_index(t_index)
+    {}
+
+    Direction Route::Iterator::operator * () const noexcept
+    {
+        return (*m_route)[m_index];
+    }
+
+    Route::Iterator& Route::Iterator::operator ++ () noexcept
+    {
+        m_index += 1;
+        return *this;
+    }
+
+    bool Route::Iterator::operator == (const Iterator& other) const noexcept
+    {
+        return m_route == other.m_route && m_index == other.m_index;
+    }
+
+    bool Route::Iterator::operator != (const Iterator& other) const noexcept
+    {
+        return !(*this == other);
+    }
+
+    Route::Route() noexcept
+        : m_inline(0), m_words(memory::ArenaAllocator<std::uint64_t>(nullptr, memory::Subsystem::Routes)), m_size(0)
+    {}
+
+    Route::Route(const memory::ArenaAllocator<std::uint64_t>& allocator) noexcept
+        : m_inline(0),
+        m_words(memory::ArenaAllocator<std::uint64_t>(allocator.getArena(), memory::Subsystem::Routes)),
+        m_size(0)
+    {}
+
+    Route::Route(const std::initializer_list<Direction> directions) noexcept : Route()
+    {
+        for (const auto& direction : directions) {
+            push_back(direction);
+        }
+    }
+
+    Route::Iterator Route::begin() const noexcept
+    {
+        return Iterator(*this, 0);
+    }
+
+    Route::Iterator Route::end() const noexcept
+    {
+        return Iterator(*this, m_size);
+    }
+
+    bool Route::empty() const noexcept
+    {
+        return m_size == 0;
+    }
+
+    void Route::push_back(const Direction direction) noexcept
+    {
+        const auto bits = static_cast<std::uint64_t>(direction) & 3;
+        if (m_size < gInlineSteps) {
+            m_inline |= bits << (m_size * 2);
+        }
+        else {
+            const auto step = m_size - gInlineSteps;
+            if (step % 32 == 0) {
+                m_words.push_back(0);
             }
+            m_words.back() |= bits << (step % 32 * 2);
+        }
+        m_size += 1;
+    }
+
+    size_t Route::size() const noexcept
+    {
+        return m_size;
+    }
 
-            auto tad = Tadpole(*this);
-            tad.head = neig.node;
-            tad.nodes.push_back(pos);
-            // Adding neighbor direction because this direction is point
-            // on this node realtive to previous. This allows to construct
-            // a full path to the head.
-            tad.route.push_back(neig.direction);
-            passages.push_back(std::move(tad));
+    Direction Route::operator [] (const size_t index) const noexcept
+    {
+        if (index < gInlineSteps) {
+            return static_cast<Direction>((m_inline >> (index * 2)) & 3);
         }
-        return passages;
+        const auto step = index - gInlineSteps;
+        return static_cast<Direction>((m_words[step / 32] >> (step % 32 * 2)) & 3);
     }
 
     /* Node */
@@ -155,14 +304,14 @@ namespace graph {
         return m_deadend;
     }
 
-    std::vector<Neighbor> Node::getNeighbors() const noexcept
+    std::array<Neighbor, 4> Node::getNeighbors() const noexcept
     {
-        return {
+        return { {
             Neighbor(m_left, graph::Direction::Left),
             Neighbor(m_right, graph::Direction::Right),
             Neighbor(m_up, graph::Direction::Up),
             Neighbor(m_down, graph::Direction::Down),
-        };
+        } };
     }
 
     std::weak_ptr<Node> Node::getNode(const Direction direction) const noexcept
@@ -184,100 +333,214 @@ namespace graph {
         m_deadend = false;
     }
 
+    /* Graph::Search */
+
+    Graph::Search::Search(const memory::ArenaAllocator<Step>& allocator) noexcept
+        : steps(allocator),
+        seen(0, std::hash<std::uint64_t>(), std::equal_to<std::uint64_t>(), allocator),
+        begin(0),
+        end(0),
+        pruned(false),
+        paused(false)
+    {}
+
     /* Graph */
 
-    Graph::Graph(std::shared_ptr<Node> start) noexcept
-        : m_start(start),
+    Graph::Graph(std::shared_ptr<Node> start, memory::Arena* arena) noexcept
+        : m_arena(arena),
+        m_rectangle(0, 0, 0, 0),
+        m_nodes(memory::ArenaAllocator<std::shared_ptr<Node>>(arena, memory::Subsystem::Nodes)),
+        m_index(
+            0,
+            std::hash<std::uint64_t>(),
+            std::equal_to<std::uint64_t>(),
+            Index::allocator_type(arena, memory::Subsystem::Nodes)),
         m_current(start),
-        m_rectangle(0, 0, 0, 0)
+        m_start(start),
+        m_width(0),
+        m_height(0),
+        m_expansions(0),
+        m_search(memory::ArenaAllocator<Step>(arena, memory::Subsystem::Search)),
+        m_budget_hits(0),
+        m_tiered(false),
+        m_tiles(
+            0,
+            std::hash<std::uint64_t>(),
+            std::equal_to<std::uint64_t>(),
+            Tiles::allocator_type(arena, memory::Subsystem::Tiles)),
+        m_cold(0)
     {
-        m_nodes.push_back(start);
+        addNode(start);
     }
 
-    void Graph::createNodeAt(const Direction direction) noexcept
+    bool Graph::alignWith(Graph& graph, const int width, const int height) noexcept
     {
-        const auto pos = m_current.lock()->m_position.at(direction);
-
-        std::weak_ptr<Node> target;
-        for (const auto& node : m_nodes) {
-            if (pos == node->m_position) {
-                target = node;
-            }
-        }
-        if (target.expired()) {
-            const auto node = std::make_shared<Node>(pos, false);
-            m_nodes.push_back(node);
-            target = node;
-        }
+        normalizeRect();
+        graph.normalizeRect();
 
-        // Link relative to target node
-        // This need because target may exists at another existing node
-        // and connection relative to this node will not connect target
-        // with another nodes.
+        const auto this_cn_spot = m_current.lock()->m_position;
+        const auto other_cn_spot = graph.m_current.lock()->m_position;
 
-        // This is a flat version of the linking algorithm which works
-        // with O(n) complexity.
+        // Possible spot for centering map
+        const auto cn_invariants = {
+            this_cn_spot,                                  // Center
+            Position(this_cn_spot.x - 1, this_cn_spot.y),  // Left-center
+            Position(this_cn_spot.x + 1, this_cn_spot.y),  // Right-center
+            Position(this_cn_spot.x, this_cn_spot.y + 1),  // Up-center
+            Position(this_cn_spot.x, this_cn_spot.y - 1)   // Down-center
+        };
+        for (const auto& cn_spot : cn_invariants) {
+            normalizeRect();
+            graph.normalizeRect();
 
-        const auto updated_node = target.lock();
-        const auto neighbors = updated_node->getNeighbors();
+            const auto delta_x = cn_spot.x - other_cn_spot.x;
+            const auto delta_y = cn_spot.y - other_cn_spot.y;
 
-        auto lt_node_expired = neighbors[0].node.expired();
-        const auto lt_node_pos = pos.at(Direction::Left);
+            // If delta more then 0 then move other graph else move this graph
+            // that will help align map at (0;0)
 
-        auto rt_node_expired = neighbors[1].node.expired();
-        const auto rt_node_pos = pos.at(Direction::Right);
+            const auto this_delta_x = delta_x < 0 ? -delta_x : 0;
+            const auto this_delta_y = delta_y < 0 ? -delta_y : 0;
+            const auto other_delta_x = delta_x > 0 ? delta_x : 0;
+            const auto other_delta_y = delta_y > 0 ? delta_y : 0;
 
-        auto up_node_expired = neighbors[2].node.expired();
-        const auto up_node_pos = pos.at(Direction::Up);
+            // These rects can be out of bounds, in that case connection spot is wrong. Rects start at (0;0),
+            // so they are checked before any node is shifted
+            if (m_rectangle.max_x + this_delta_x >= width ||
+                m_rectangle.max_y + this_delta_y >= height ||
+                graph.m_rectangle.max_x + other_delta_x >= width ||
+                graph.m_rectangle.max_y + other_delta_y >= height) {
+                continue;
+            }
 
-        auto dn_node_expired = neighbors[3].node.expired();
-        const auto dn_node_pos = pos.at(Direction::Down);
+            shiftRect(this_delta_x, this_delta_y);
+            graph.shiftRect(other_delta_x, other_delta_y);
 
-        for (const auto& node : m_nodes) {
-            if (lt_node_expired && lt_node_pos == node->m_position) {
-                updated_node->m_left = node;
-                node->m_right = updated_node;
-                lt_node_expired = false;
-            }
-            else if (rt_node_expired && rt_node_pos == node->m_position) {
-                updated_node->m_right = node;
-                node->m_left = updated_node;
-                rt_node_expired = false;
-            }
-            else if (up_node_expired && up_node_pos == node->m_position) {
-                updated_node->m_up = node;
-                node->m_down = updated_node;
-                up_node_expired = false;
+            if (isIntersectedWith(graph)) {
+                continue;
             }
-            else if (dn_node_expired && dn_node_pos == node->m_position) {
-                updated_node->m_down = node;
-                node->m_up = updated_node;
-                dn_node_expired = false;
+
+            return true;
+        }
+        return false;
+    }
+
+    void Graph::createNodeAt(const Direction direction) noexcept
+    {
+        const auto pos = m_current.lock()->m_position.at(direction);
+        if (!isKnown(pos)) {
+            const auto node = makeNode(m_arena, pos, false);
+            addNode(node);
+            linkNode(node, m_index);
+        }
+    }
+
+    void Graph::createNodesAt(const unsigned char mask) noexcept
+    {
+        const auto current = m_current.lock();
+        const auto directions = { Direction::Left, Direction::Right, Direction::Up, Direction::Down };
+
+        // Known nodes are already linked with all adjacent ones, so only new nodes are linked
+        for (const auto& direction : directions) {
+            if (!(mask & (1 << static_cast<int>(direction)))) {
+                continue;
             }
-            else if (!(lt_node_expired || rt_node_expired || up_node_expired || dn_node_expired)) {
-                // Node updating is over
-                break;
+            const auto pos = current->m_position.at(direction);
+            if (!isKnown(pos)) {
+                const auto node = makeNode(m_arena, pos, false);
+                addNode(node);
+                linkNode(node, m_index);
             }
         }
-        updateRectangle(pos);
     }
 
-    std::vector<Direction> Graph::findUnvisitedNode() const noexcept
+    Route Graph::findUnvisitedNode() noexcept
     {
-        std::vector<Tadpole> tads{ Tadpole({}, {}, m_current) };
-        while (!tads.empty()) {
-            std::vector<Tadpole> processed;
-            processed.reserve(tads.size() * 4);
-            for (const auto& tad : tads) {
-                if (!tad.head.lock()->m_visited) {
-                    return tad.route;
+        // Breadth-first search keeps only the first route to each node. Nodes are expanded in the order of their
+        // routes and neighbors in (left, right, up, down) order, so the first unvisited node has the smallest route.
+        // Layer is checked as a whole before it is expanded, so nodes of the last layer are never expanded
+        const auto allocator = memory::ArenaAllocator<Step>(m_arena, memory::Subsystem::Search);
+        auto search = Search(allocator);
+        if (m_search.paused) {
+            search = std::move(m_search);
+            m_search.paused = false;
+        }
+        else {
+            const auto current = m_current.lock();
+            search.steps.reserve(m_nodes.size());
+            search.seen.reserve(m_nodes.size());
+            search.pruned = !current->m_deadend;
+            search.steps.push_back(Step{ current, 0, Direction::Left });
+            search.seen.insert(getKey(current->m_position));
+            search.end = search.steps.size();
+        }
+        auto& steps = search.steps;
+        auto& seen = search.seen;
+
+        const auto directions = { Direction::Left, Direction::Right, Direction::Up, Direction::Down };
+
+        // The budget is checked only between layers, so the clock is read once per layer
+        const auto started = m_budget.microseconds != 0
+            ? std::chrono::steady_clock::now()
+            : std::chrono::steady_clock::time_point();
+        std::uint64_t spent = 0;
+        for (size_t begin = search.begin, end = search.end; begin < end; begin = end, end = steps.size()) {
+            for (auto index = begin; index < end; ++index) {
+                if (steps[index].node->m_visited) {
+                    continue;
+                }
+                memory::Vector<Direction> directions(allocator);
+                for (auto step = index; step != 0; step = steps[step].parent) {
+                    directions.push_back(steps[step].direction);
+                }
+
+                Route route(m_arena);
+                for (auto direction = directions.rbegin(); direction != directions.rend(); ++direction) {
+                    route.push_back(*direction);
+                }
+                return route;
+            }
+
+            if (spent != 0 && (
+                (m_budget.expansions != 0 && spent >= m_budget.expansions) ||
+                (m_budget.microseconds != 0 && std::chrono::steady_clock::now() - started
+                    >= std::chrono::microseconds(m_budget.microseconds)))) {
+                search.begin = begin;
+                search.end = end;
+                search.paused = true;
+                m_search = std::move(search);
+                m_budget_hits += 1;
+                return Route();
+            }
+
+            m_expansions += end - begin;
+            spent += end - begin;
+            for (auto index = begin; index < end; ++index) {
+                // Cold neighbors are paged in before the node is expanded, so they are linked. Cold deadends are
+                // skipped by the pruned search anyway
+                for (const auto& direction : directions) {
+                    const auto next = steps[index].node->m_position.at(direction);
+                    const auto tile = m_cold != 0 ? m_tiles.find(getKey(getBlock(next))) : m_tiles.end();
+                    if (tile != m_tiles.end()
+                        && (tile->second.passages & getBit(next)) != 0
+                        && !(search.pruned && (tile->second.deadends & getBit(next)) != 0)) {
+                        thaw(tile->second.origin);
+                    }
+                }
+                for (const auto& neig : steps[index].node->getNeighbors()) {
+                    const auto next = neig.node.lock();
+                    if (next && !(search.pruned && next->m_deadend) && seen.insert(getKey(next->m_position)).second) {
+                        steps.push_back(Step{ next, index, neig.direction });
+                    }
                 }
-                const auto subtads = tad.produceTadpole();
-                processed.insert(processed.end(), subtads.begin(), subtads.end());
             }
-            tads = processed;
         }
-        return {};
+        return Route();
+    }
+
+    std::uint64_t Graph::getBudgetHits() const noexcept
+    {
+        return m_budget_hits;
     }
 
     std::weak_ptr<Node> Graph::getCurrent() const noexcept
@@ -285,24 +548,48 @@ namespace graph {
         return m_current;
     }
 
+    const Rectangle& Graph::getRectangle() const noexcept
+    {
+        return m_rectangle;
+    }
+
+    std::uint64_t Graph::getExpansions() const noexcept
+    {
+        return m_expansions;
+    }
+
+    std::uint64_t Graph::getFingerprint() const noexcept
+    {
+        return m_fingerprint.get(m_rectangle);
+    }
+
     size_t Graph::getNodeCount() const noexcept
     {
-        return m_nodes.size();
+        return m_nodes.size() + m_cold;
     }
 
-    std::vector<Position> Graph::getPassagesPositions() const noexcept
+    std::weak_ptr<Node> Graph::getStart() const noexcept
     {
-        std::vector<Position> passages;
-        passages.reserve(m_nodes.size());
+        return m_start;
+    }
+
+    memory::Vector<Position> Graph::getPassagesPositions() const noexcept
+    {
+        memory::Vector<Position> passages(memory::ArenaAllocator<Position>(m_arena, memory::Subsystem::Maps));
+        passages.reserve(m_nodes.size() + m_cold);
         for (const auto& node : m_nodes) {
             passages.push_back(node->m_position);
         }
+        findColdNode([&passages](const Position& pos) {
+            passages.push_back(pos);
+            return false;
+        });
         return passages;
     }
 
-    std::vector<Position> Graph::getWallsPositions() const noexcept
+    memory::Vector<Position> Graph::getWallsPositions() const noexcept
     {
-        std::vector<Position> walls;
+        memory::Vector<Position> walls(memory::ArenaAllocator<Position>(m_arena, memory::Subsystem::Maps));
         walls.reserve(m_nodes.size() * 4);
         for (const auto& node : m_nodes) {
             if (!node->m_visited) {
@@ -310,12 +597,22 @@ namespace graph {
             }
 
             for (const auto& neig : node->getNeighbors()) {
-                if (!neig.node.expired()) {
-                    continue;
+                const auto pos = node->m_position.at(neig.direction);
+                if (neig.node.expired() && !isCold(pos)) {
+                    walls.push_back(pos);
                 }
-                walls.push_back(node->m_position.at(neig.direction));
             }
         }
+        // Cold nodes are visited and not linked, so their walls are unknown cells around them
+        const auto directions = { Direction::Left, Direction::Right, Direction::Up, Direction::Down };
+        findColdNode([this, &walls, &directions](const Position& cold) {
+            for (const auto& direction : directions) {
+                if (!isKnown(cold.at(direction))) {
+                    walls.push_back(cold.at(direction));
+                }
+            }
+            return false;
+        });
         return walls;
     }
 
@@ -325,8 +622,106 @@ namespace graph {
             throw std::runtime_error(
                 "Current node is expired or equals nullptr_t. This occurred because preivous node wasn't updated");
         }
+        dropSearch();
+
+        // Blocks around the entered one are paged in before the move, so the route may come back to the cold
+        // block and neighbors of the current node are always linked
+        const auto left = getBlock(m_current.lock()->m_position);
+        const auto entered = getBlock(m_current.lock()->m_position.at(direction));
+        const auto moved = m_tiered && (entered.x != left.x || entered.y != left.y);
+        if (moved) {
+            for (int y = entered.y - gBlockSide; y <= entered.y + gBlockSide; y += gBlockSide) {
+                for (int x = entered.x - gBlockSide; x <= entered.x + gBlockSide; x += gBlockSide) {
+                    thaw(Position(x, y));
+                }
+            }
+        }
+
         m_current = m_current.lock()->getNode(direction);
         m_current.lock()->m_visited = true;
+        if (moved) {
+            compact();
+        }
+    }
+
+    bool Graph::isAlignable(const Graph& graph, const Rectangle& deltas, Position& delta) const noexcept
+    {
+        const auto this_current = m_current.lock()->m_position;
+        const auto other_current = graph.m_current.lock()->m_position;
+        for (int delta_y = deltas.min_y; delta_y <= deltas.max_y; ++delta_y) {
+            for (int delta_x = deltas.min_x; delta_x <= deltas.max_x; ++delta_x) {
+                const auto shift_x = m_rectangle.min_x + delta_x - graph.m_rectangle.min_x;
+                const auto shift_y = m_rectangle.min_y + delta_y - graph.m_rectangle.min_y;
+                if (other_current.x + shift_x == this_current.x && other_current.y + shift_y == this_current.y) {
+                    continue;
+                }
+
+                bool covered = false;
+                for (size_t index = 0; !covered && index < graph.m_nodes.size(); ++index) {
+                    const auto& node = graph.m_nodes[index];
+                    const auto pos = Position(node->m_position.x + shift_x, node->m_position.y + shift_y);
+                    covered = isWall(pos);
+                    if (covered || !node->m_visited) {
+                        continue;
+                    }
+                    for (const auto& neig : node->getNeighbors()) {
+                        if (neig.node.expired()
+                            && !graph.isCold(node->m_position.at(neig.direction))
+                            && isKnown(pos.at(neig.direction))) {
+                            covered = true;
+                            break;
+                        }
+                    }
+                }
+                // Cold nodes of another graph are visited, so their walls are unknown cells around them
+                covered = covered || graph.findColdNode([this, &graph, shift_x, shift_y](const Position& cold) {
+                    const auto pos = Position(cold.x + shift_x, cold.y + shift_y);
+                    const auto directions = { Direction::Left, Direction::Right, Direction::Up, Direction::Down };
+                    if (isWall(pos)) {
+                        return true;
+                    }
+                    for (const auto& direction : directions) {
+                        if (!graph.isKnown(cold.at(direction)) && isKnown(pos.at(direction))) {
+                            return true;
+                        }
+                    }
+                    return false;
+                });
+                if (!covered) {
+                    delta = Position(delta_x, delta_y);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    bool Graph::isOutside(const Position& pos) const noexcept
+    {
+        if (m_width <= 0 || m_height <= 0) {
+            return false;
+        }
+        return pos.x < m_rectangle.max_x - m_width + 1
+            || pos.x > m_rectangle.min_x + m_width - 1
+            || pos.y < m_rectangle.max_y - m_height + 1
+            || pos.y > m_rectangle.min_y + m_height - 1;
+    }
+
+    bool Graph::isWall(const Position& pos) const noexcept
+    {
+        if (isKnown(pos)) {
+            return false;
+        }
+        // Every open neighbor of the visited node is known, so unknown cell next to it is a wall. Cold nodes are
+        // always visited
+        const auto directions = { Direction::Left, Direction::Right, Direction::Up, Direction::Down };
+        for (const auto& direction : directions) {
+            const auto found = m_index.find(getKey(pos.at(direction)));
+            if ((found != m_index.end() && found->second->m_visited) || isCold(pos.at(direction))) {
+                return true;
+            }
+        }
+        return false;
     }
 
     bool Graph::isExplored() const noexcept
@@ -340,32 +735,94 @@ namespace graph {
         return true;
     }
 
+    bool Graph::isSearching() const noexcept
+    {
+        return m_search.paused;
+    }
+
     bool Graph::isIntersectedWith(const Graph& graph) const noexcept
     {
-        const auto t_passages = getPassagesPositions();
-        const auto t_walls = getWallsPositions();
+        for (const auto& wall : getWallsPositions()) {
+            if (isKnown(wall) || graph.isKnown(wall)) {
+                return true;
+            }
+        }
+        for (const auto& wall : graph.getWallsPositions()) {
+            if (isKnown(wall) || graph.isKnown(wall)) {
+                return true;
+            }
+        }
+        return false;
+    }
 
-        const auto o_passages = graph.getPassagesPositions();
-        const auto o_walls = graph.getWallsPositions();
+    void Graph::load(std::istream& input)
+    {
+        const auto min_x = binary::read<std::int32_t>(input);
+        const auto min_y = binary::read<std::int32_t>(input);
+        const auto max_x = binary::read<std::int32_t>(input);
+        const auto max_y = binary::read<std::int32_t>(input);
+        const auto count = binary::read<std::uint64_t>(input);
+        const auto current = binary::read<std::uint64_t>(input);
+        const auto start = binary::read<std::uint64_t>(input);
+        if (count == 0 || current >= count || start >= count) {
+            throw std::runtime_error("Corrupted graph data");
+        }
 
-        std::vector<Position> passages;
-        passages.reserve(t_passages.size() + o_passages.size());
-        passages.insert(passages.end(), t_passages.begin(), t_passages.end());
-        passages.insert(passages.end(), o_passages.begin(), o_passages.end());
+        m_rectangle = Rectangle(min_x, min_y, max_x, max_y);
+        m_nodes.clear();
+        m_nodes.reserve(static_cast<size_t>(count));
+        m_index.clear();
+        m_index.reserve(static_cast<size_t>(count));
+        m_tiles.clear();
+        m_cold = 0;
+        m_fingerprint = Fingerprint();
+
+        for (std::uint64_t number = 0; number < count; ++number) {
+            const auto x = binary::read<std::int32_t>(input);
+            const auto y = binary::read<std::int32_t>(input);
+            const auto flags = binary::read<std::uint8_t>(input);
+
+            const auto node = makeNode(m_arena, Position(x, y), (flags & 1) != 0);
+            node->m_deadend = (flags & 2) != 0;
+            addNode(node);
+        }
 
-        std::vector<Position> walls;
-        walls.reserve(t_walls.size() + o_walls.size());
-        walls.insert(walls.end(), t_walls.begin(), t_walls.end());
-        walls.insert(walls.end(), o_walls.begin(), o_walls.end());
+        for (const auto& node : m_nodes) {
+            linkNode(node, m_index);
+        }
+        m_current = m_nodes[static_cast<size_t>(current)];
+        m_start = m_nodes[static_cast<size_t>(start)];
+    }
 
-        for (const auto& passage : passages) {
-            for (const auto& wall : walls) {
-                if (passage == wall) {
-                    return true;
-                }
+    void Graph::merge(const Graph& graph) noexcept
+    {
+        thaw();
+        dropSearch();
+        const auto known = m_nodes.size();
+        for (const auto& other : graph.m_nodes) {
+            const auto found = m_index.find(getKey(other->m_position));
+            if (found != m_index.end()) {
+                found->second->m_visited = found->second->m_visited || other->m_visited;
+                continue;
             }
+            addNode(makeNode(m_arena, other->m_position, other->m_visited));
         }
-        return false;
+        graph.findColdNode([this](const Position& cold) {
+            const auto found = m_index.find(getKey(cold));
+            if (found != m_index.end()) {
+                found->second->m_visited = true;
+            }
+            else {
+                addNode(makeNode(m_arena, cold, true));
+            }
+            return false;
+        });
+
+        // Old nodes are linked already, so only new ones are looked up
+        for (size_t number = known; number < m_nodes.size(); ++number) {
+            linkNode(m_nodes[number], m_index);
+        }
+        resetDeadendNodes();
     }
 
     inline void Graph::normalizeRect() noexcept
@@ -373,73 +830,146 @@ namespace graph {
         shiftRect(-m_rectangle.min_x, -m_rectangle.min_y);
     }
 
-    void Graph::resetDeadendNodes() const noexcept
+    void Graph::pruneFrontier() noexcept
+    {
+        if (m_width <= 0 || m_height <= 0) {
+            return;
+        }
+        dropSearch();
+
+        // Pruned node doesn't change known cells of other nodes: all its neighbor cells were known before,
+        // so the order of nodes doesn't matter
+        for (const auto& node : m_nodes) {
+            if (node->m_visited) {
+                continue;
+            }
+            bool known = true;
+            for (const auto& neig : node->getNeighbors()) {
+                const auto pos = node->m_position.at(neig.direction);
+                if (!neig.node.expired() || isCold(pos)) {
+                    continue;
+                }
+                if (!isOutside(pos) && !isWall(pos)) {
+                    known = false;
+                    break;
+                }
+            }
+            node->m_visited = known;
+        }
+    }
+
+    void Graph::rasterize(render::Tile& tile) const noexcept
+    {
+        for (const auto& node : m_nodes) {
+            tile.setPassage(node->m_position);
+            if (!node->m_visited) {
+                continue;
+            }
+
+            for (const auto& neig : node->getNeighbors()) {
+                const auto pos = node->m_position.at(neig.direction);
+                if (neig.node.expired() && !isCold(pos)) {
+                    tile.setWall(pos);
+                }
+            }
+        }
+        const auto directions = { Direction::Left, Direction::Right, Direction::Up, Direction::Down };
+        findColdNode([this, &tile, &directions](const Position& cold) {
+            tile.setPassage(cold);
+            for (const auto& direction : directions) {
+                if (!isKnown(cold.at(direction))) {
+                    tile.setWall(cold.at(direction));
+                }
+            }
+            return false;
+        });
+    }
+
+    void Graph::resetDeadendNodes() noexcept
     {
+        thaw();
         for (const auto& node : m_nodes) {
             node->resetDeadend();
         }
     }
 
-    void Graph::resetVisitedNodes() const noexcept
+    void Graph::resetVisitedNodes() noexcept
     {
+        thaw();
+        dropSearch();
         for (const auto& node : m_nodes) {
             node->m_visited = false;
         }
         m_current.lock()->m_visited = true;
     }
 
-    std::string Graph::restoreMap(Graph& graph, const char this_start, const char other_start) noexcept
+    std::string Graph::restoreMap(
+        Graph& graph,
+        const char this_start,
+        const char other_start,
+        const int width,
+        const int height) noexcept
     {
-        normalizeRect();
-        graph.normalizeRect();
-
-        const auto this_cn_spot = m_current.lock()->m_position;
-        const auto other_cn_spot = graph.m_current.lock()->m_position;
-
-        // Possible spot for centering map
-        const auto cn_invariants = {
-            this_cn_spot,                                  // Center
-            Position(this_cn_spot.x - 1, this_cn_spot.y),  // Left-center
-            Position(this_cn_spot.x + 1, this_cn_spot.y),  // Right-center
-            Position(this_cn_spot.x, this_cn_spot.y + 1),  // Up-center
-            Position(this_cn_spot.x, this_cn_spot.y - 1)   // Down-center
-        };
-        for (const auto& cn_spot : cn_invariants) {
-            normalizeRect();
-            graph.normalizeRect();
-
-            const auto delta_x = cn_spot.x - other_cn_spot.x;
-            const auto delta_y = cn_spot.y - other_cn_spot.y;
-
-            // If delta more then 0 then move other graph else move this graph
-            // that will help align map at (0;0)
-
-            const auto this_delta_x = delta_x < 0 ? -delta_x : 0;
-            const auto this_delta_y = delta_y < 0 ? -delta_y : 0;
-            const auto other_delta_x = delta_x > 0 ? delta_x : 0;
-            const auto other_delta_y = delta_y > 0 ? delta_y : 0;
+        if (!alignWith(graph, width, height)) {
+            return std::string();
+        }
+        return drawMap(graph, this_start, other_start, width, height);
+    }
 
-            shiftRect(this_delta_x, this_delta_y);
-            graph.shiftRect(other_delta_x, other_delta_y);
+    void Graph::save(std::ostream& output) const
+    {
+        const auto current = m_current.lock();
+        const auto start = m_start.lock();
+        std::uint64_t current_index = 0;
+        std::uint64_t start_index = 0;
+        for (size_t number = 0; number < m_nodes.size(); ++number) {
+            if (m_nodes[number] == current) {
+                current_index = number;
+            }
+            if (m_nodes[number] == start) {
+                start_index = number;
+            }
+        }
 
-            const auto this_rect = m_rectangle;
-            const auto other_rect = graph.m_rectangle;
+        binary::write<std::int32_t>(output, m_rectangle.min_x);
+        binary::write<std::int32_t>(output, m_rectangle.min_y);
+        binary::write<std::int32_t>(output, m_rectangle.max_x);
+        binary::write<std::int32_t>(output, m_rectangle.max_y);
+        binary::write<std::uint64_t>(output, getNodeCount());
+        binary::write<std::uint64_t>(output, current_index);
+        binary::write<std::uint64_t>(output, start_index);
+        for (const auto& node : m_nodes) {
+            binary::write<std::int32_t>(output, node->m_position.x);
+            binary::write<std::int32_t>(output, node->m_position.y);
+            binary::write<std::uint8_t>(output, static_cast<std::uint8_t>(
+                static_cast<int>(node->m_visited) | static_cast<int>(node->m_deadend) << 1));
+        }
+        // Cold nodes are written after hot ones as visited deadends, so they are loaded as hot nodes
+        findColdNode([&output](const Position& cold) {
+            binary::write<std::int32_t>(output, cold.x);
+            binary::write<std::int32_t>(output, cold.y);
+            binary::write<std::uint8_t>(output, 3);
+            return false;
+        });
+    }
 
-            // These rects can be out of bounds, in that case connection spot is wrong
-            if (this_rect.max_x > 9 ||
-                this_rect.max_y > 9 ||
-                other_rect.max_x > 9 ||
-                other_rect.max_y > 9) {
-                continue;
-            }
+    void Graph::setBounds(const int width, const int height) noexcept
+    {
+        m_width = width;
+        m_height = height;
+    }
 
-            if (isIntersectedWith(graph)) {
-                continue;
-            }
+    void Graph::setBudget(const Budget& budget) noexcept
+    {
+        m_budget = budget;
+    }
 
-            return drawMap(graph, this_start, other_start);
+    void Graph::setTiering(const bool enabled) noexcept
+    {
+        m_tiered = enabled;
+        if (!enabled) {
+            thaw();
         }
-        return std::string();
     }
 
     void Graph::shiftRect(const int delta_x, const int delta_y) noexcept
@@ -447,60 +977,215 @@ namespace graph {
         if (delta_x == 0 && delta_y == 0) {
             return;
         }
+        // Blocks depend on positions, so cold nodes are paged in before they are shifted
+        thaw();
 
         m_rectangle.min_x += delta_x;
         m_rectangle.min_y += delta_y;
         m_rectangle.max_x += delta_x;
         m_rectangle.max_y += delta_y;
+        m_fingerprint.shift(delta_x, delta_y);
+        dropSearch();
 
+        // Keys of the index depend on positions, so the index is built again
+        m_index.clear();
         for (const auto& node : m_nodes) {
             node->m_position.x += delta_x;
             node->m_position.y += delta_y;
+            m_index.emplace(getKey(node->m_position), node);
         }
     }
 
-    std::string Graph::drawMap(const Graph& graph, const char this_start, const char other_start) noexcept
+    std::string Graph::drawMap(
+        const Graph& graph,
+        const char this_start,
+        const char other_start,
+        const int width,
+        const int height) noexcept
     {
-        char map[10][10] = {};
-        memset((char*)map, '?', 100);
+        std::ostringstream sheet;
+        render::Renderer(*this, graph, this_start, other_start, width, height).write(sheet);
+        auto map = sheet.str();
+        // The map belongs to the caller, so it stays live in the ledger
+        memory::countAllocation(memory::Subsystem::Maps, map.capacity());
+        return map;
+    }
 
-        for (const auto& passage : getPassagesPositions()) {
-            map[passage.y][passage.x] = '.';
+    void Graph::dropSearch() const noexcept
+    {
+        if (m_search.paused) {
+            m_search.paused = false;
+            m_search.steps.clear();
+            m_search.seen.clear();
         }
+    }
 
-        for (const auto& passage : graph.getPassagesPositions()) {
-            map[passage.y][passage.x] = '.';
+    std::uint64_t Graph::getBit(const Position& pos) noexcept
+    {
+        const auto block = getBlock(pos);
+        return static_cast<std::uint64_t>(1) << ((pos.y - block.y) * gBlockSide + pos.x - block.x);
+    }
+
+    Position Graph::getBlock(const Position& pos) noexcept
+    {
+        // Blocks are aligned by gBlockSide, so negative positions are rounded down
+        const auto round_down = [](const int value) {
+            return (value >= 0 ? value : value - (gBlockSide - 1)) / gBlockSide * gBlockSide;
+        };
+        return Position(round_down(pos.x), round_down(pos.y));
+    }
+
+    std::uint64_t Graph::getKey(const Position& pos) noexcept
+    {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(pos.x)) << 32)
+            | static_cast<std::uint32_t>(pos.y);
+    }
+
+    void Graph::linkNode(const std::shared_ptr<Node>& node, const Index& index) noexcept
+    {
+        const auto left = index.find(getKey(node->m_position.at(Direction::Left)));
+        if (left != index.end()) {
+            node->m_left = left->second;
+            left->second->m_right = node;
         }
+        const auto right = index.find(getKey(node->m_position.at(Direction::Right)));
+        if (right != index.end()) {
+            node->m_right = right->second;
+            right->second->m_left = node;
+        }
+        const auto up = index.find(getKey(node->m_position.at(Direction::Up)));
+        if (up != index.end()) {
+            node->m_up = up->second;
+            up->second->m_down = node;
+        }
+        const auto down = index.find(getKey(node->m_position.at(Direction::Down)));
+        if (down != index.end()) {
+            node->m_down = down->second;
+            down->second->m_up = node;
+        }
+    }
 
-        for (const auto& wall : getWallsPositions()) {
-            // Walls can be border of the labyrinth that can't be draw in 10x10 map
-            if (wall.x > 9 || wall.x < 0 || wall.y > 9 || wall.y < 0) {
+    void Graph::addNode(const std::shared_ptr<Node>& node) noexcept
+    {
+        dropSearch();
+        m_nodes.push_back(node);
+        m_index.emplace(getKey(node->m_position), node);
+        m_fingerprint.add(node->m_position);
+        updateRectangle(node->m_position);
+    }
+
+    void Graph::compact() noexcept
+    {
+        using Blocks = std::unordered_map<
+            std::uint64_t,
+            bool,
+            std::hash<std::uint64_t>,
+            std::equal_to<std::uint64_t>,
+            memory::ArenaAllocator<std::pair<const std::uint64_t, bool>>>;
+
+        // Deadend checks read only the current node and nodes around it, so flags of cold nodes never change
+        const auto current = getBlock(m_current.lock()->m_position);
+        const auto start = getBlock(m_start.lock()->m_position);
+        auto blocks = Blocks(
+            0,
+            std::hash<std::uint64_t>(),
+            std::equal_to<std::uint64_t>(),
+            Blocks::allocator_type(m_arena, memory::Subsystem::Tiles));
+        for (const auto& node : m_nodes) {
+            const auto block = getBlock(node->m_position);
+            if (isNear(block, current) || (block.x == start.x && block.y == start.y)) {
                 continue;
             }
-            map[wall.y][wall.x] = '#';
+            auto& visited = blocks.emplace(getKey(block), true).first->second;
+            visited = visited && node->m_visited;
         }
 
-        for (const auto& wall : graph.getWallsPositions()) {
-            if (wall.x > 9 || wall.x < 0 || wall.y > 9 || wall.y < 0) {
+        // Hot neighbors keep weak links to cold nodes, so links become expired when nodes are released
+        size_t count = 0;
+        for (const auto& node : m_nodes) {
+            const auto block = getBlock(node->m_position);
+            const auto found = blocks.find(getKey(block));
+            if (found == blocks.end() || !found->second) {
                 continue;
             }
-            map[wall.y][wall.x] = '#';
+            // The block which was paged in may be compacted again
+            auto& tile = m_tiles.emplace(getKey(block), Tile{ block, 0, 0, 0 }).first->second;
+            const auto bit = getBit(node->m_position);
+            tile.passages |= bit;
+            tile.visited |= bit;
+            tile.deadends |= node->m_deadend ? bit : 0;
+            m_index.erase(getKey(node->m_position));
+            count += 1;
+        }
+        if (count == 0) {
+            return;
         }
+        m_nodes.erase(
+            std::remove_if(m_nodes.begin(), m_nodes.end(), [this](const std::shared_ptr<Node>& node) {
+                return m_index.count(getKey(node->m_position)) == 0;
+            }),
+            m_nodes.end());
+        m_cold += count;
+    }
 
-        const auto this_start_pos = m_start.lock()->m_position;
-        map[this_start_pos.y][this_start_pos.x] = this_start;
+    bool Graph::isCold(const Position& pos) const noexcept
+    {
+        if (m_cold == 0) {
+            return false;
+        }
+        const auto found = m_tiles.find(getKey(getBlock(pos)));
+        return found != m_tiles.end() && (found->second.passages & getBit(pos)) != 0;
+    }
 
-        const auto other_start_pos = graph.m_start.lock()->m_position;
-        map[other_start_pos.y][other_start_pos.x] = other_start;
+    bool Graph::isKnown(const Position& pos) const noexcept
+    {
+        return m_index.count(getKey(pos)) != 0 || isCold(pos);
+    }
 
-        std::string sheet;
-        for (int y = 9; y > -1; --y) {
-            for (int x = 0; x < 10; ++x) {
-                sheet.push_back(map[y][x]);
+    bool Graph::isNear(const Position& block, const Position& other) noexcept
+    {
+        return block.x - other.x <= gBlockSide && other.x - block.x <= gBlockSide
+            && block.y - other.y <= gBlockSide && other.y - block.y <= gBlockSide;
+    }
+
+    void Graph::thaw() noexcept
+    {
+        if (m_cold == 0) {
+            return;
+        }
+        dropSearch();
+        while (!m_tiles.empty()) {
+            thaw(m_tiles.begin()->second.origin);
+        }
+    }
+
+    void Graph::thaw(const Position& block) noexcept
+    {
+        const auto found = m_tiles.find(getKey(block));
+        if (found == m_tiles.end()) {
+            return;
+        }
+        // The block may be the origin of the tile itself, so the tile is copied before it is erased
+        const auto tile = found->second;
+        m_tiles.erase(found);
+
+        // Cold nodes are already in the fingerprint and the rectangle, so they are only listed and indexed
+        const auto known = m_nodes.size();
+        for (int bit = 0; bit < gBlockSide * gBlockSide; ++bit) {
+            if ((tile.passages >> bit & 1) == 0) {
+                continue;
             }
-            sheet.push_back('\n');
+            const auto pos = Position(tile.origin.x + bit % gBlockSide, tile.origin.y + bit / gBlockSide);
+            const auto node = makeNode(m_arena, pos, (tile.visited >> bit & 1) != 0);
+            node->m_deadend = (tile.deadends >> bit & 1) != 0;
+            m_nodes.push_back(node);
+            m_index.emplace(getKey(pos), node);
+        }
+        m_cold -= m_nodes.size() - known;
+
+        for (size_t number = known; number < m_nodes.size(); ++number) {
+            linkNode(m_nodes[number], m_index);
         }
-        return sheet;
     }
 
     void Graph::updateRectangle(const Position& pos) noexcept
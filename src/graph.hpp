@@ -1,9 +1,24 @@
 #pragma once
 
+#include "memory.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <istream>
 #include <memory>
+#include <ostream>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
+namespace render {
+    class Tile;  // Predefinition
+}
+
 namespace graph {
     class Node;  // Predefinition
 
@@ -43,19 +58,94 @@ namespace graph {
         Rectangle(const int t_min_x, const int t_min_y, const int t_max_x, const int t_max_y) noexcept;
     };
 
-    /// Represents a route to the head relative to the current node using the world directions and the graph directions
-    struct Tadpole {
-        std::vector<Direction> route;  //!< The route to head node
-        std::vector<Position> nodes;   //!< Positions of visited by route nodes
-        std::weak_ptr<Node> head;
+    /// Represents the limit of one call of Graph::findUnvisitedNode. The search which is over the limit is paused
+    /// and resumed by the next call. The limit is checked before every layer, so one layer is always expanded and
+    /// the limit may be passed by the last layer. Zero field is unlimited
+    struct Budget {
+        std::uint64_t expansions;    //!< Nodes which one call may expand
+        std::uint64_t microseconds;  //!< Time which one call may take
+
+        /// Creates the unlimited budget
+        Budget() noexcept;
+        Budget(const std::uint64_t t_expansions, const std::uint64_t t_microseconds) noexcept;
+
+        /// @returns True when any field is limited
+        bool isLimited() const noexcept;
+    };
+
+    /// Represents the translation-invariant fingerprint of a set of cells. Every cell adds A^x * B^y (modulo 2^64
+    /// with odd A and B) to the sum, so the set is updated in O(1) per cell and moving all cells only multiplies
+    /// the sum by one factor
+    class Fingerprint {
+    public:
+        Fingerprint() noexcept;
+
+    public:
+        /// Adds the cell to the set. The cell must not be in the set already
+        void add(const Position& pos) noexcept;
 
-        Tadpole(
-            const std::vector<Direction> t_route,
-            const std::vector<Position> t_nodes,
-            const std::weak_ptr<Node> t_head) noexcept;
+        /// @param rect Rectangle which covers all cells of the set
+        ///
+        /// @returns Hash of the set moved so that the rectangle starts at (0;0) mixed with sizes of the rectangle.
+        /// Sets which are equal up to translation have equal hashes
+        std::uint64_t get(const Rectangle& rect) const noexcept;
+
+        /// Moves all cells of the set by delta
+        void shift(const int delta_x, const int delta_y) noexcept;
+
+    private:
+        /// @returns A^x * B^y modulo 2^64 for any x and y
+        static std::uint64_t getFactor(const int x, const int y) noexcept;
 
-        /// @returns The vector of tadpoles from this to the neighbor passages in the labyrinth
-        std::vector<Tadpole> produceTadpole() const noexcept;
+    private:
+        std::uint64_t m_sum;
+    };
+
+    /// Represents a route as the stream of directions packed by 2 bits per step. The first 32 steps are kept
+    /// inside the object and only longer routes use the allocator
+    class Route {
+    public:
+        /// Iterates directions of the route in order
+        class Iterator {
+        public:
+            Iterator(const Route& t_route, const size_t t_index) noexcept;
+
+            Direction operator * () const noexcept;
+            Iterator& operator ++ () noexcept;
+            bool operator == (const Iterator& other) const noexcept;
+            bool operator != (const Iterator& other) const noexcept;
+
+        private:
+            const Route* m_route;
+            size_t m_index;
+        };
+
+        Route() noexcept;
+        explicit Route(const memory::ArenaAllocator<std::uint64_t>& allocator) noexcept;
+        Route(const std::initializer_list<Direction> directions) noexcept;
+
+    public:
+        Iterator begin() const noexcept;
+        Iterator end() const noexcept;
+
+        /// @returns True if the route has no steps
+        bool empty() const noexcept;
+
+        /// Adds the step at the end of the route
+        void push_back(const Direction direction) noexcept;
+
+        /// @returns Amount of steps
+        size_t size() const noexcept;
+
+        /// @returns Direction of the step at the index
+        Direction operator [] (const size_t index) const noexcept;
+
+    private:
+        static const size_t gInlineSteps = 32;  //!< Amount of steps which are kept inside the object
+
+        std::uint64_t m_inline;               //!< The first steps of the route
+        memory::Vector<std::uint64_t> m_words;  //!< Steps after the inline ones, 32 steps per word
+        size_t m_size;
     };
 
     /// Represents the graph node with a position
@@ -81,7 +171,7 @@ namespace graph {
 
         /// @returns All neighbors of the current node even when some of them is wall. In that case some
         /// of them is expired
-        std::vector<Neighbor> getNeighbors() const noexcept;
+        std::array<Neighbor, 4> getNeighbors() const noexcept;
 
         /// @returns The node at the indicated direction even when direction point to the wall. In that case 
         /// weak ptr is expired
@@ -99,37 +189,86 @@ namespace graph {
         std::weak_ptr<Node> m_down;
 
     private:
+        friend class Graph;  // Graph saves and loads deadend flags
+
         bool m_deadend;
     };
 
-    /// Represents a node net which represent explored parts of the labyrinth
+    /// Represents a node net which represent explored parts of the labyrinth. Nodes, tadpoles and routes of the graph
+    /// are kept in the arena when it is given, so the graph of the finished run is released by Arena::reset
     class Graph {
     public:
-        Graph(std::shared_ptr<Node> start) noexcept;
+        /// @param start The start node. Must be allocated in the same arena (see Graph::makeNode)
+        /// @param arena Arena of the run or nullptr to use the global heap
+        Graph(std::shared_ptr<Node> start, memory::Arena* arena = nullptr) noexcept;
 
     public:
+        /// @returns A new node which is allocated in the arena or in the global heap if arena is nullptr
+        template <typename... Args>
+        static std::shared_ptr<Node> makeNode(memory::Arena* arena, Args&&... args)
+        {
+            return std::allocate_shared<Node>(
+                memory::ArenaAllocator<Node>(arena, memory::Subsystem::Nodes), std::forward<Args>(args)...);
+        }
+
+    public:
+        /// Shifts this and another graph so they are aligned relative to one of five spots: current node position
+        /// (if they had met here) and left, right, up, and down positions relative to the current node. Graphs are
+        /// aligned when both fit width x height map with the origin at (0;0) and walls of each graph do not cover
+        /// passages of another.
+        ///
+        /// @returns True when graphs are aligned. Otherwise graphs are left shifted some way
+        bool alignWith(Graph& graph, const int width, const int height) noexcept;
+
         /// Creates or find the node at the direction relative to the current and linking this node to another known nodes.
-        /// Have O(n) complexity
+        /// Have O(1) complexity
         void createNodeAt(const Direction direction) noexcept;
 
+        /// Creates or finds all nodes around the current one which are marked as open in the mask and links them
+        /// to another known nodes. Nodes are found by the index of positions, so it has O(1) complexity
+        ///
+        /// @param mask Open directions where bit N is set for the direction with N underlying value
+        void createNodesAt(const unsigned char mask) noexcept;
+
         /// Searching the nearest node. Nodes are tooks in (left, right, up, down) order.
-        /// Flat version of recursive function - will not occur stack overflow error. Have O(n) complexity
+        /// Flat breadth-first search - will not occur stack overflow error. Have O(n) complexity. Deadend nodes
+        /// are not reached unless the current node is a deadend. Cold blocks are paged in when the search reaches
+        /// them (see Graph::setTiering)
         ///
-        /// @returns The nearest unvisited node using tadpoles. 
-        std::vector<Direction> findUnvisitedNode() const noexcept;
+        /// @returns The lexicographically smallest route among the shortest routes to unvisited nodes. The empty
+        /// route when there are no reachable unvisited nodes or when the search was paused by the budget (see
+        /// Graph::isSearching)
+        Route findUnvisitedNode() noexcept;
+
+        /// @returns Amount of searches of Graph::findUnvisitedNode which were paused by the budget
+        std::uint64_t getBudgetHits() const noexcept;
 
         /// @returns The latest visited node (node where person right now in Fairyland)
         std::weak_ptr<Node> getCurrent() const noexcept;
 
-        /// @returns Amount of known nodes
+        /// @returns Amount of nodes which were expanded by all searches of Graph::findUnvisitedNode
+        std::uint64_t getExpansions() const noexcept;
+
+        /// @returns Translation-invariant hash of known nodes (see Fingerprint). When the graph is explored, walls
+        /// are exactly unknown cells next to its nodes, so two explored graphs of the same part of the labyrinth
+        /// always have equal fingerprints. Have O(1) complexity
+        std::uint64_t getFingerprint() const noexcept;
+
+        /// @returns Amount of known nodes including cold ones
         size_t getNodeCount() const noexcept;
 
+        /// @returns Rectangle which covers all known nodes
+        const Rectangle& getRectangle() const noexcept;
+
+        /// @returns The start node of the graph
+        std::weak_ptr<Node> getStart() const noexcept;
+
         /// @returns Positions of known nodes
-        std::vector<Position> getPassagesPositions() const noexcept;
+        memory::Vector<Position> getPassagesPositions() const noexcept;
 
         /// @returns Amount of expired neighbor nodes only of visited nodes. These neighbors represent walls
         /// in the labyrinth
-        std::vector<Position> getWallsPositions() const noexcept;
+        memory::Vector<Position> getWallsPositions() const noexcept;
 
         // Sets node at the direction as current and makes it visited. Must be used only after `Pathfinder::updateNode`.
         // For now `Pathfinder::updateNode` is called in `Pathfinder::go` which must be used for this kind of operations
@@ -138,21 +277,65 @@ namespace graph {
         // @throws std::runtime_error when current node is expired (when previous wasn't updated)
         void go(const Direction direction);
 
+        /// Checks if another graph can lay in one labyrinth with this one when its rectangle starts at any of
+        /// the deltas relative to the rectangle of this graph. Graphs can lay together when passages of each one
+        /// don't cover walls of another and current nodes are different. Have O(m * k) complexity where k is amount
+        /// of deltas
+        ///
+        /// @param deltas Rectangle of offsets where every offset is checked
+        /// @param delta The first offset where graphs can lay together. Changed only when the result is true
+        bool isAlignable(const Graph& graph, const Rectangle& deltas, Position& delta) const noexcept;
+
         /// Checks if all nodes are visited
         bool isExplored() const noexcept;
 
+        /// Checks if the last search of Graph::findUnvisitedNode was paused by the budget. The next call resumes it
+        /// while the graph is not changed, otherwise the search starts again
+        bool isSearching() const noexcept;
+
+        /// Checks if the cell at the position provably lays outside of the labyrinth. The labyrinth has width x height
+        /// size and covers the rectangle of known nodes, so cells which are farther from the rectangle cannot be
+        /// inside. Always false when bounds are unknown (see Graph::setBounds)
+        bool isOutside(const Position& pos) const noexcept;
+
+        /// Checks if the cell at the position is a known wall: it is not a known node but it is next to a visited
+        /// node. Have O(1) complexity
+        bool isWall(const Position& pos) const noexcept;
+
+        /// Replaces all nodes of the graph with nodes written by Graph::save. Links between nodes are restored
+        /// from their positions because every two adjacent known nodes are always linked. Have O(n) complexity
+        ///
+        /// @throws std::runtime_error when data is corrupted
+        void load(std::istream& input);
+
         /// Checks if walls of this graph are intersected with passages of another graph and does the same for walls
-        /// of another graph. Have O((n + m)^2) complexity
+        /// of another graph. Have O(n + m) complexity
         bool isIntersectedWith(const Graph& graph) const noexcept;
 
+        /// Adds nodes of another graph to this one. Graphs must already share the frame (see Graph::alignWith).
+        /// Coincident nodes become one node which is visited if it is visited in any graph, so walls of both graphs
+        /// are kept. New nodes are linked with all adjacent nodes and deadend flags are reset. Current and start
+        /// nodes of this graph are not changed. Have O(n + m) complexity
+        void merge(const Graph& graph) noexcept;
+
         /// Shifts nodes position such way that graph will have only non-negative nodes positions
         inline void normalizeRect() noexcept;
 
+        /// Marks unvisited nodes as visited when every neighbor cell is already known: it is a known node, a known
+        /// wall (see Graph::isWall) or a cell outside of the labyrinth (see Graph::isOutside). Visit of such node
+        /// gives nothing new, so it is pruned from the frontier of Graph::findUnvisitedNode. Does nothing when
+        /// bounds are unknown. Have O(n) complexity
+        void pruneFrontier() noexcept;
+
+        /// Draws known nodes as passages and expired neighbors of visited nodes as walls right in the tile.
+        /// Have O(n) complexity
+        void rasterize(render::Tile& tile) const noexcept;
+
         /// Resets deadend node's internal variables. Must be used before rerun the labyrinth
-        void resetDeadendNodes() const noexcept;
+        void resetDeadendNodes() noexcept;
 
         /// Resets visit of all node except the current. Must be used before rerun the labyrinth
-        void resetVisitedNodes() const noexcept;
+        void resetVisitedNodes() noexcept;
 
         /// Tries to restore map using information of this and partner's graphs. Does it relative to five spots:
         /// Current node position (if they had met here) and left, right, up, and down positions relative
@@ -163,16 +346,158 @@ namespace graph {
         /// @param graph Graph which will be tried to combines relative to this
         /// @param this_start Char that represents this start on the future map
         /// @param other_start Char that represents start of other graph on the future map
+        /// @param width Width of the labyrinth
+        /// @param height Height of the labyrinth
         /// 
         /// @returns Map of the labyrinth or empty string
-        std::string restoreMap(Graph& graph, const char this_start, const char other_start) noexcept;
+        std::string restoreMap(
+            Graph& graph,
+            const char this_start,
+            const char other_start,
+            const int width,
+            const int height) noexcept;
+
+        /// Writes positions and visited and deadend flags of nodes in their order with rectangle, current and start
+        /// nodes. Links are not written
+        void save(std::ostream& output) const;
+
+        /// Sets size of the labyrinth for the bounds inference. Zero size disables the inference, so it must be
+        /// disabled before rerun where every node must be visited
+        void setBounds(const int width, const int height) noexcept;
+
+        /// Sets the limit of every call of Graph::findUnvisitedNode. The graph is not limited by default
+        void setBudget(const Budget& budget) noexcept;
+
+        /// Enables compaction of cold blocks. Cells are split into blocks of gBlockSide x gBlockSide and every
+        /// block whose nodes are all visited is kept as one tile of bits instead of nodes when the current node
+        /// moves to another block. Blocks around the current node and the block of the start node always stay hot,
+        /// so deadend checks see the same nodes as without tiles. The search pages in blocks which it reaches and
+        /// the graph pages in all of them when it is changed as a whole, so only the frontier and its surroundings
+        /// are kept as nodes. The graph is not tiered by default
+        void setTiering(const bool enabled) noexcept;
 
         /// Shifts graph by delta_x and delta_y relative to the current position
         void shiftRect(const int delta_x, const int delta_y) noexcept;
 
     private:
-        /// Draws map using shifted graphs (this and other). Must be used only when rectangle contains by 10x10 map
-        std::string drawMap(const Graph& graph, const char this_start, const char other_start) noexcept;
+        /// Draws map using shifted graphs (this and other) with render::Renderer. Must be used only when rectangle
+        /// contains by width x height map
+        std::string drawMap(
+            const Graph& graph,
+            const char this_start,
+            const char other_start,
+            const int width,
+            const int height) noexcept;
+
+        /// Represents the node which is reached by the search and the step from its parent
+        struct Step {
+            std::shared_ptr<Node> node;
+            size_t parent;
+            Direction direction;
+        };
+
+        /// Represents keys of positions which were reached by the search
+        using Seen = std::unordered_set<
+            std::uint64_t,
+            std::hash<std::uint64_t>,
+            std::equal_to<std::uint64_t>,
+            memory::ArenaAllocator<std::uint64_t>>;
+
+        /// Represents the state of Graph::findUnvisitedNode which is kept while the search is paused
+        struct Search {
+            memory::Vector<Step> steps;
+            Seen seen;
+            size_t begin;  //!< The first step of the layer which is not expanded yet
+            size_t end;    //!< The step after that layer
+            bool pruned;   //!< True when deadend nodes are not reached
+            bool paused;
+
+            explicit Search(const memory::ArenaAllocator<Step>& allocator) noexcept;
+        };
+
+        /// Forgets the paused search, so the next one starts again. Must be used whenever nodes are changed
+        void dropSearch() const noexcept;
+
+        /// Represents nodes by keys of their positions
+        using Index = std::unordered_map<
+            std::uint64_t,
+            std::shared_ptr<Node>,
+            std::hash<std::uint64_t>,
+            std::equal_to<std::uint64_t>,
+            memory::ArenaAllocator<std::pair<const std::uint64_t, std::shared_ptr<Node>>>>;
+
+        /// Side of the square block of cells which is compacted into one tile
+        static const int gBlockSide = 8;
+
+        /// Represents the block of cold nodes. Bit N stands for the cell (N % gBlockSide; N / gBlockSide) relative
+        /// to the origin of the block
+        struct Tile {
+            Position origin;
+            std::uint64_t passages;  //!< Cells which are nodes
+            std::uint64_t visited;
+            std::uint64_t deadends;
+        };
+
+        /// Represents tiles by keys of origins of their blocks
+        using Tiles = std::unordered_map<
+            std::uint64_t,
+            Tile,
+            std::hash<std::uint64_t>,
+            std::equal_to<std::uint64_t>,
+            memory::ArenaAllocator<std::pair<const std::uint64_t, Tile>>>;
+
+        /// @returns Bit of the position in the tile of its block
+        static std::uint64_t getBit(const Position& pos) noexcept;
+
+        /// @returns Origin of the block which contains the position
+        static Position getBlock(const Position& pos) noexcept;
+
+        /// @returns The position packed into one key
+        static std::uint64_t getKey(const Position& pos) noexcept;
+
+        /// Links the node with all adjacent nodes of the index in both directions
+        static void linkNode(const std::shared_ptr<Node>& node, const Index& index) noexcept;
+
+        /// Adds the node to the list, the index, the fingerprint and the rectangle. Node must be new
+        void addNode(const std::shared_ptr<Node>& node) noexcept;
+
+        /// Calls the function with the position of every cold node until it returns true
+        ///
+        /// @returns True when the function has returned true
+        template <typename Function>
+        bool findColdNode(const Function& function) const
+        {
+            for (const auto& entry : m_tiles) {
+                const auto& tile = entry.second;
+                for (int bit = 0; bit < gBlockSide * gBlockSide; ++bit) {
+                    if ((tile.passages >> bit & 1) != 0
+                        && function(Position(tile.origin.x + bit % gBlockSide, tile.origin.y + bit / gBlockSide))) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        /// Compacts every block whose nodes are all visited except blocks around the current node and the block
+        /// of the start node. Have O(n) complexity
+        void compact() noexcept;
+
+        /// Checks if the cell at the position is a cold node (see Graph::setTiering)
+        bool isCold(const Position& pos) const noexcept;
+
+        /// Checks if the cell at the position is a known node, either hot or cold
+        bool isKnown(const Position& pos) const noexcept;
+
+        /// Checks if blocks are the same or adjacent, diagonally too
+        static bool isNear(const Position& block, const Position& other) noexcept;
+
+        /// Pages all cold nodes in and links them. Must be used before the graph is changed as a whole. Have O(n)
+        /// complexity
+        void thaw() noexcept;
+
+        /// Pages nodes of the block in and links them. Does nothing when the block is hot
+        void thaw(const Position& block) noexcept;
 
         /// Updates rectangle if the given position has max or / and min values then rect has. Rect has this meaning:
         /// [min x, min y; max x, max y]
@@ -180,9 +505,21 @@ namespace graph {
         void updateRectangle(const Position& pos) noexcept;
 
     private:
+        memory::Arena* m_arena;
         Rectangle m_rectangle;
-        std::vector<std::shared_ptr<Node>> m_nodes;
+        Fingerprint m_fingerprint;
+        memory::Vector<std::shared_ptr<Node>> m_nodes;
+        Index m_index;  //!< Nodes by their positions. Built again when nodes are shifted
         std::weak_ptr<Node> m_current;
         std::weak_ptr<Node> m_start;
+        int m_width;   //!< Width of the labyrinth or 0 when it is unknown (see Graph::setBounds)
+        int m_height;  //!< Height of the labyrinth or 0 when it is unknown
+        mutable std::uint64_t m_expansions;  //!< See Graph::getExpansions
+        Budget m_budget;
+        mutable Search m_search;              //!< The search which was paused by the budget
+        mutable std::uint64_t m_budget_hits;  //!< See Graph::getBudgetHits
+        bool m_tiered;  //!< See Graph::setTiering
+        Tiles m_tiles;  //!< Cold nodes which are compacted
+        size_t m_cold;  //!< Amount of cold nodes
     };
 }
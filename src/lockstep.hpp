@@ -0,0 +1,317 @@
+#pragma once
+
+#include "bitboard.hpp"
+#include "fairy_tail.hpp"
+#include "game.hpp"
+#include "memory.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace lockstep {
+    /// Pal which is used by lanes. Lanes simulate only labyrinths which fit it
+    using Pal = bitboard::Pal<10, 10>;
+
+    /// Simulates N independent games side by side in lockstep. World state and sensing of all lanes are kept
+    /// in struct-of-arrays layout, so one turn of every lane is applied by plain loops over arrays which
+    /// compiler turns into vector operations. Finished lanes are masked out and refilled with the next world.
+    ///
+    /// Decisions are made by game::Match of every lane, so results are the same as game::play gives
+    template <std::size_t N>
+    class Lanes {
+    public:
+        static constexpr std::size_t cells = 10 * 10;  //!< Max cells of the labyrinth which fits Pal
+
+        Lanes() noexcept;
+
+    public:
+        /// @returns True if the world can be simulated by lanes
+        static bool fits(const Fairyland& world) noexcept;
+
+        /// Plays games in every world. Worlds are used only as source of labyrinths, their state is not changed
+        ///
+        /// @throws std::runtime_error when the pathfinder gives invalid direction or game has too many turns
+        ///
+        /// @returns Results in the same order as worlds are
+        std::vector<game::Result> run(const std::vector<std::shared_ptr<Fairyland>>& worlds);
+
+    private:
+        /// Loads labyrinth and start positions of the world into the lane and starts its match
+        void load(const std::size_t lane, const Fairyland& world, const std::size_t index) noexcept;
+
+        /// Asks the lane match for the next turn and fills the lane steps
+        ///
+        /// @returns False when the game of the lane is over
+        bool plan(const std::size_t lane) noexcept;
+
+        /// Applies planned turn to the world state of all lanes at once
+        void advance();
+
+        /// @returns Cell index delta of the direction in the labyrinth with the width
+        static std::int32_t delta(const Direction direction, const std::int32_t width) noexcept;
+
+        /// @returns Open-direction bit which is required for the direction. Zero for Direction::Pass
+        static std::uint8_t bit(const Direction direction) noexcept;
+
+    private:
+        // World state of lanes
+        std::uint8_t m_active[N];        //!< One when the lane plays a game otherwise zero
+        std::int32_t m_width[N];         //!< Width of the lane labyrinth
+        std::int32_t m_height[N];        //!< Height of the lane labyrinth
+        std::int32_t m_ivan[N];          //!< Ivan's cell index
+        std::int32_t m_elena[N];         //!< Elena's cell index
+        std::int32_t m_turns[N];         //!< Turn count of the lane world
+        std::uint8_t m_masks[N * cells]; //!< Open-direction masks of every cell of the lane labyrinth
+
+        // Planned turn of lanes
+        std::int32_t m_ivan_step[N];     //!< Ivan's cell index delta
+        std::int32_t m_elena_step[N];    //!< Elena's cell index delta
+        std::uint8_t m_ivan_bit[N];      //!< Open-direction bit required by Ivan's move
+        std::uint8_t m_elena_bit[N];     //!< Open-direction bit required by Elena's move
+
+        // Sensing of lanes after the turn
+        std::uint8_t m_ivan_mask[N];     //!< Open directions of Ivan's cell
+        std::uint8_t m_elena_mask[N];    //!< Open directions of Elena's cell
+        std::uint8_t m_meeting[N];       //!< One when pals had met at this turn
+
+        // Pathfinding state of lanes
+        std::size_t m_index[N];          //!< Index of the lane world in the batch
+        Pal m_ivan_pals[N];
+        Pal m_elena_pals[N];
+        std::unique_ptr<game::Match<Pal>> m_matches[N];
+    };
+
+    /// Plays games in every world using lanes for worlds which fit them and game::play for others
+    ///
+    /// @returns Results in the same order as worlds are
+    template <std::size_t N>
+    std::vector<game::Result> simulate(const std::vector<std::shared_ptr<Fairyland>>& worlds);
+
+    /* Lanes */
+
+    template <std::size_t N>
+    Lanes<N>::Lanes() noexcept
+        : m_active{},
+        m_width{},
+        m_height{},
+        m_ivan{},
+        m_elena{},
+        m_turns{},
+        m_masks{},
+        m_ivan_step{},
+        m_elena_step{},
+        m_ivan_bit{},
+        m_elena_bit{},
+        m_ivan_mask{},
+        m_elena_mask{},
+        m_meeting{},
+        m_index{}
+    {}
+
+    template <std::size_t N>
+    bool Lanes<N>::fits(const Fairyland& world) noexcept
+    {
+        return Pal::fits(world.getWidth(), world.getHeight());
+    }
+
+    template <std::size_t N>
+    std::vector<game::Result> Lanes<N>::run(const std::vector<std::shared_ptr<Fairyland>>& worlds)
+    {
+        auto results = std::vector<game::Result>(
+            worlds.size(),
+            game::Result(game::Verdict::AlgorithmError, 0, std::string()));
+
+        size_t next = 0;
+        const auto refill = [&](const std::size_t lane) {
+            while (next < worlds.size()) {
+                load(lane, *worlds[next], next);
+                next += 1;
+                if (plan(lane)) {
+                    return;
+                }
+                // The game could be over before the first turn
+                results[m_index[lane]] = game::Result(m_matches[lane]->getVerdict(), 0, m_matches[lane]->getMessage());
+            }
+            m_active[lane] = 0;
+        };
+
+        for (std::size_t lane = 0; lane < N; ++lane) {
+            refill(lane);
+        }
+
+        auto active = true;
+        while (active) {
+            advance();
+
+            active = false;
+            for (std::size_t lane = 0; lane < N; ++lane) {
+                if (!m_active[lane]) {
+                    continue;
+                }
+
+                const auto& match = m_matches[lane];
+                match->commit(m_meeting[lane] != 0, m_ivan_mask[lane], m_elena_mask[lane]);
+                if (!plan(lane)) {
+                    results[m_index[lane]] = game::conclude(*match, m_turns[lane], m_width[lane], m_height[lane]);
+                    refill(lane);
+                }
+                active = active || m_active[lane];
+            }
+        }
+        return results;
+    }
+
+    template <std::size_t N>
+    void Lanes<N>::load(const std::size_t lane, const Fairyland& world, const std::size_t index) noexcept
+    {
+        const auto width = static_cast<std::int32_t>(world.getWidth());
+        const auto height = static_cast<std::int32_t>(world.getHeight());
+        for (std::int32_t y = 0; y < height; ++y) {
+            for (std::int32_t x = 0; x < width; ++x) {
+                m_masks[lane * cells + y * width + x] = world.getOpenMask(x, y);
+            }
+        }
+
+        const auto ivan = world.getPosition(Character::Ivan);
+        const auto elena = world.getPosition(Character::Elena);
+
+        m_active[lane] = 1;
+        m_width[lane] = width;
+        m_height[lane] = height;
+        m_ivan[lane] = ivan.second * width + ivan.first;
+        m_elena[lane] = elena.second * width + elena.first;
+        m_turns[lane] = 0;
+        m_index[lane] = index;
+
+        m_ivan_pals[lane] = Pal();
+        m_elena_pals[lane] = Pal();
+        m_matches[lane].reset(new game::Match<Pal>(
+            m_ivan_pals[lane],
+            m_elena_pals[lane],
+            m_masks[lane * cells + m_ivan[lane]],
+            m_masks[lane * cells + m_elena[lane]],
+            width,
+            height));
+    }
+
+    template <std::size_t N>
+    bool Lanes<N>::plan(const std::size_t lane) noexcept
+    {
+        auto turn = game::Turn(Direction::Pass, Direction::Pass);
+        if (!m_matches[lane]->next(turn)) {
+            return false;
+        }
+        m_ivan_step[lane] = delta(turn.ivan, m_width[lane]);
+        m_elena_step[lane] = delta(turn.elena, m_width[lane]);
+        m_ivan_bit[lane] = bit(turn.ivan);
+        m_elena_bit[lane] = bit(turn.elena);
+        return true;
+    }
+
+    template <std::size_t N>
+    void Lanes<N>::advance()
+    {
+        // Inactive lanes have zero steps and bits, so they are not moved and always valid
+        std::uint8_t invalid = 0;
+        for (std::size_t lane = 0; lane < N; ++lane) {
+            m_ivan_step[lane] *= m_active[lane];
+            m_elena_step[lane] *= m_active[lane];
+            m_ivan_bit[lane] *= m_active[lane];
+            m_elena_bit[lane] *= m_active[lane];
+            invalid |= static_cast<std::uint8_t>(
+                (m_masks[lane * cells + m_ivan[lane]] & m_ivan_bit[lane]) != m_ivan_bit[lane] ||
+                (m_masks[lane * cells + m_elena[lane]] & m_elena_bit[lane]) != m_elena_bit[lane]);
+        }
+        if (invalid) {
+            throw std::runtime_error("Invalid pal's direction");
+        }
+
+        std::int32_t turns = 0;
+        for (std::size_t lane = 0; lane < N; ++lane) {
+            const auto ivan = m_ivan[lane];
+            const auto elena = m_elena[lane];
+            m_ivan[lane] = ivan + m_ivan_step[lane];
+            m_elena[lane] = elena + m_elena_step[lane];
+            m_meeting[lane] = static_cast<std::uint8_t>(
+                m_ivan[lane] == m_elena[lane] || ivan == m_elena[lane] && elena == m_ivan[lane]);
+            m_turns[lane] += m_active[lane];
+            turns = turns > m_turns[lane] ? turns : m_turns[lane];
+        }
+        if (turns >= 1000000) {
+            throw std::runtime_error("Too many turns");
+        }
+
+        for (std::size_t lane = 0; lane < N; ++lane) {
+            m_ivan_mask[lane] = m_masks[lane * cells + m_ivan[lane]];
+            m_elena_mask[lane] = m_masks[lane * cells + m_elena[lane]];
+        }
+    }
+
+    template <std::size_t N>
+    std::int32_t Lanes<N>::delta(const Direction direction, const std::int32_t width) noexcept
+    {
+        switch (direction) {
+            case Direction::Left:
+                return -1;
+            case Direction::Right:
+                return 1;
+            case Direction::Up:
+                return -width;
+            case Direction::Down:
+                return width;
+            default:
+                return 0;
+        }
+    }
+
+    template <std::size_t N>
+    std::uint8_t Lanes<N>::bit(const Direction direction) noexcept
+    {
+        switch (direction) {
+            case Direction::Left:
+                return 1;
+            case Direction::Right:
+                return 2;
+            case Direction::Up:
+                return 4;
+            case Direction::Down:
+                return 8;
+            default:
+                return 0;
+        }
+    }
+
+    /* Functions */
+
+    template <std::size_t N>
+    std::vector<game::Result> simulate(const std::vector<std::shared_ptr<Fairyland>>& worlds)
+    {
+        std::vector<std::shared_ptr<Fairyland>> fitting;
+        std::vector<std::size_t> indexes;
+        auto results = std::vector<game::Result>(
+            worlds.size(),
+            game::Result(game::Verdict::AlgorithmError, 0, std::string()));
+
+        memory::Arena arena;
+        for (std::size_t index = 0; index < worlds.size(); ++index) {
+            if (Lanes<N>::fits(*worlds[index])) {
+                fitting.push_back(worlds[index]);
+                indexes.push_back(index);
+            }
+            else {
+                results[index] = game::play(worlds[index], arena);
+            }
+        }
+
+        // Lanes are too large for the stack when N is big enough
+        const auto lanes = std::unique_ptr<Lanes<N>>(new Lanes<N>());
+        const auto lane_results = lanes->run(fitting);
+        for (std::size_t index = 0; index < lane_results.size(); ++index) {
+            results[indexes[index]] = lane_results[index];
+        }
+        return results;
+    }
+}
@@ -1,8 +1,17 @@
+#include "checkpoint.hpp"
+#include "crowd.hpp"
+#include "embed.h"
 #include "fairy_tail.hpp"
-#include "graph.hpp"
-#include "pathfinder.hpp"
+#include "game.hpp"
+#include "memory.hpp"
+#include "server.hpp"
 
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <string>
 
 /// This function is being used when program is going to close. Writes warning message and awaits input on true value
@@ -21,160 +30,166 @@ int main(int argc, char** argv)
 {
     // When TEST_MODE is true, program shall not waiting for input for close
     bool TEST_MODE = false;
-    for (size_t index = 1; index < argc; ++index) {
+    // Snapshots of the game are written to the checkpoint file, so the long game can be resumed after a crash
+    std::string checkpoint_path;
+    double checkpoint_interval = 60;
+    bool resume = false;
+    // In the crowd mode all agents of the labyrinth ('@', '&' and every '*') are gathered
+    bool crowd_mode = false;
+    // Memory of the run is accounted by subsystems and phases and reported to stderr
+    bool memory_report = false;
+    // In the server mode labyrinths are requested by frames from stdin or the Unix domain socket
+    bool serve_mode = false;
+    std::string socket_path;
+    size_t workers = 1;
+    // Every search of pals may be limited, so no turn takes longer than the budget
+    auto budget = graph::Budget();
+    // Graphs of large labyrinths may keep explored blocks compacted, so memory follows the frontier
+    bool tiered = false;
+    // Advices of both pals of large labyrinths may be given on two threads
+    bool parallel = false;
+    for (int index = 1; index < argc; ++index) {
+        if (strcmp("--checkpoint", argv[index]) == 0 && index + 1 < argc) {
+            checkpoint_path = argv[++index];
+        }
+        else if (strcmp("--checkpoint_interval", argv[index]) == 0 && index + 1 < argc) {
+            checkpoint_interval = std::atof(argv[++index]);
+        }
+        else if (strcmp("--resume", argv[index]) == 0) {
+            resume = true;
+        }
+        else if (strcmp("--crowd", argv[index]) == 0) {
+            crowd_mode = true;
+        }
+        else if (strcmp("--memory", argv[index]) == 0) {
+            memory_report = true;
+        }
+        else if (strcmp("--serve", argv[index]) == 0) {
+            serve_mode = true;
+        }
+        else if (strcmp("--socket", argv[index]) == 0 && index + 1 < argc) {
+            socket_path = argv[++index];
+        }
+        else if (strcmp("--workers", argv[index]) == 0 && index + 1 < argc) {
+            workers = static_cast<size_t>(std::atoi(argv[++index]));
+        }
+        else if (strcmp("--budget-expansions", argv[index]) == 0 && index + 1 < argc) {
+            budget.expansions = std::strtoull(argv[++index], nullptr, 10);
+        }
+        else if (strcmp("--budget-us", argv[index]) == 0 && index + 1 < argc) {
+            budget.microseconds = std::strtoull(argv[++index], nullptr, 10);
+        }
+        else if (strcmp("--tiered", argv[index]) == 0) {
+            tiered = true;
+        }
+        else if (strcmp("--parallel", argv[index]) == 0) {
+            parallel = true;
+        }
         TEST_MODE = TEST_MODE
             || strcmp("-t", argv[index]) == 0
             || strcmp("--test_mode", argv[index]) == 0;
     }
 
-    /* -------------------------- INITIALIZATION -------------------------- */
-
-    const auto world = std::make_shared<Fairyland>();
-
-    const auto ivan_g = std::make_shared<graph::Graph>(std::make_shared<graph::Node>(true));
-    const auto ivan_p = pathfinder::Pathfinder(world, Character::Ivan, ivan_g);
-    ivan_p.updateNode();
-    ivan_g->getCurrent().lock()->deadendCheck();
-
-    const auto elena_g = std::make_shared<graph::Graph>(std::make_shared<graph::Node>(true));
-    const auto elena_p = pathfinder::Pathfinder(world, Character::Elena, elena_g);
-    elena_p.updateNode();
-    elena_g->getCurrent().lock()->deadendCheck();
-
-    /* -------------------------------------------------------------------- */
-
-    /* ------------------------ THE MAIN ALGORITHM ------------------------ */
-
-    auto ivan_a = ivan_p.getAdvice();
-    auto elena_a = elena_p.getAdvice();
-
-    auto syncronized = true;
-    auto meeting = false;
-
-    while (!meeting) {
-        if (!syncronized) {
-            ivan_a = ivan_p.getAdvice();
-            elena_a = elena_p.getAdvice();
+    if (serve_mode) {
+        server::Server server(workers, budget);
+        if (socket_path.empty()) {
+            server.serve(std::cin, std::cout);
         }
-
-        if (ivan_a.type == pathfinder::AdviceType::Move) {
-            if (elena_a.type == pathfinder::AdviceType::Move) {
-                // Both must go until met or somebody reach spot
-                // In second case this person needs new advice
-                const auto ivan_d = ivan_a.route.size();
-                const auto elena_d = elena_a.route.size();
-                const auto distance = ivan_d < elena_d ? ivan_d : elena_d;
-
-                for (size_t index = 0; index < distance && !meeting; ++index) {
-                    meeting = pathfinder::movePals(ivan_p, elena_p, ivan_a.route[index], elena_a.route[index]);
-                }
-                syncronized = false;
-            }
-            else /* elena_a.type == pathfinder::AdviceType::Rendezvous */ {
-                // Rendezvous appears only if one of them is done with the explore
-                if (elena_g->getNodeCount() < ivan_g->getNodeCount() && elena_g->isExplored()) {
-                    std::cout << "Ivan and Elena cannot meet!" << std::endl;
-                    std::cout << "Turn count: " << world->getTurnCount() << std::endl;
-                    awaiting_on_exit(!TEST_MODE);
-                    return 0;
-                }
-                for (size_t index = 0; index < ivan_a.route.size() && !meeting; ++index) {
-                    meeting = pathfinder::movePals(ivan_p, ivan_a.route[index]);
-                }
-                syncronized = false;
-            }
-        }
-        else /* ivan_a.type == pathfinder::AdviceType::Rendezvous */ {
-            // Same as previous but relative to Elena
-            if (elena_a.type == pathfinder::AdviceType::Move) {
-                if (ivan_g->getNodeCount() < elena_g->getNodeCount() && ivan_g->isExplored()) {
-                    std::cout << "Ivan and Elena cannot meet!" << std::endl;
-                    std::cout << "Turn count: " << world->getTurnCount() << std::endl;
-                    awaiting_on_exit(!TEST_MODE);
-                    return 0;
-                }
-                for (size_t index = 0; index < elena_a.route.size() && !meeting; ++index) {
-                    meeting = pathfinder::movePals(elena_p, elena_a.route[index]);
-                }
-                syncronized = false;
-            }
-            else /* elena_a.type == pathfinder::AdviceType::Rendezvous */ {
-                // That case is the most interesting because if labyrinths have the same node count
-                // then we need to check topologic and then try to concat graphs
-                if (!ivan_g->isExplored() || !elena_g->isExplored()) {
-                    std::cout << "Algorithm error: labyrinth are not explored but both pals got a Rendezvous advice" << std::endl;
-                    awaiting_on_exit(!TEST_MODE);
-                    return 0;
-                }
-
-                if (ivan_g->getNodeCount() != elena_g->getNodeCount()) {
-                    std::cout << "Ivan and Elena cannot meet!" << std::endl;
-                    std::cout << "Turn count: " << world->getTurnCount() << std::endl;
-                    awaiting_on_exit(!TEST_MODE);
-                    return 0;
-                }
-
-                // Is more effective to visit all nodes again then do something else
-                // (linking graphs, counting coordinates and extra checks in case
-                // when the labyrinth is divided on symmetric parts)
-                ivan_g->resetDeadendNodes();
-                ivan_g->resetVisitedNodes();
-                ivan_g->getCurrent().lock()->deadendCheck();
-
-                while (!meeting) {
-                    ivan_a = ivan_p.getAdvice();
-                    if (ivan_a.type == pathfinder::AdviceType::Rendezvous) {
-                        if (!ivan_g->isExplored()) {
-                            std::cout << "Algorithm error: labyrinth are not explored but Ivan got a Rendezvous advice" << std::endl;
-                            awaiting_on_exit(!TEST_MODE);
-                            return 0;
-                        }
-                        // For example, this could happen when the labyrinth have symmetric unlinked parts
-                        std::cout << "Ivan and Elena cannot meet!" << std::endl;
-                        std::cout << "Turn count: " << world->getTurnCount() << std::endl;
-                        awaiting_on_exit(!TEST_MODE);
-                        return 0;
-                    }
-                    for (size_t index = 0; index < ivan_a.route.size() && !meeting; ++index) {
-                        meeting = pathfinder::movePals(ivan_p, ivan_a.route[index]);
-                    }
-                    // Possible everlasting cycle when algorithm is broken
-                    // and give move advice even when all nodes are visited
-                }
-            }
+        else {
+            server::listen(server, socket_path);
         }
+        return 0;
     }
 
-    /* -------------------------------------------------------------------- */
-
-    /* ---------------------------- CONCLUSION ---------------------------- */
-    // At this point meeting must happened
-    std::cout << "Ivan and Elena had meet!" << std::endl;
-    std::cout << "Turn count: " << world->getTurnCount() << std::endl;
+    memory::Ledger ledger;
+    std::unique_ptr<memory::Accounting> accounting;
+    if (memory_report) {
+        accounting.reset(new memory::Accounting(ledger));
+    }
 
-    // Only two cases possible (according to the task):
-    // I. They meet at the one point
-    // II. They went through each other
-    //
-    // Task ask to give one of possible map. In first case that simple: just connect and draw.
-    // But in the second case we need to check if the general rectangle is less or equal
-    // to the labyrinth size.
+    if (crowd_mode) {
+        const auto world = std::make_shared<Fairyland>();
+        memory::Arena arena;
+        crowd::report(std::cout, crowd::gather(world, arena));
+        if (memory_report) {
+            memory::report(std::cerr, ledger);
+        }
+        awaiting_on_exit(!TEST_MODE);
+        return 0;
+    }
 
-    // Restoring map is relative operation, so I belive (I cannot check everything)
-    // that some maps could be lost, so I put check in order to take lost map variants
-    // realtive to elena. And if elena also doens't have these variants then my algorithm
-    // cannot display such map
+    if (checkpoint_path.empty()) {
+        // The single game is played by the embeddable solver as any host plays it, only files are handled here
+        std::ifstream input("input.txt", std::ios::binary);
+        if (!input.is_open()) {
+            std::cerr << "File input.txt not found" << std::endl;
+            return 1;
+        }
+        const std::string labyrinth((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+        const std::unique_ptr<vpf_solver, void (*)(vpf_solver*)> solver(vpf_solver_create(), &vpf_solver_destroy);
+        vpf_solver_set_budget(solver.get(), budget.expansions, budget.microseconds);
+        vpf_solver_set_tiering(solver.get(), tiered ? 1 : 0);
+        vpf_solver_set_parallel(solver.get(), parallel ? 1 : 0);
+        std::string moves;
+        std::string map;
+        std::string message;
+        vpf_result answer = {};
+        auto code = vpf_solve(solver.get(), labyrinth.data(), labyrinth.size(), &answer);
+        if (code == VPF_TRUNCATED) {
+            // Buffers are grown once to the reported sizes and filled without playing the game again
+            moves.resize(answer.moves.size);
+            map.resize(answer.map.size);
+            message.resize(answer.message.size);
+            answer.moves = vpf_buffer{ &moves[0], moves.size(), 0 };
+            answer.map = vpf_buffer{ &map[0], map.size(), 0 };
+            answer.message = vpf_buffer{ &message[0], message.size(), 0 };
+            code = vpf_fetch(solver.get(), &answer);
+        }
+        if (code != VPF_OK) {
+            std::cerr << "Solver cannot play the labyrinth" << std::endl;
+            return 1;
+        }
+        // The reason of the invalid labyrinth is already written by Fairyland::check
+        if (answer.verdict == VPF_VERDICT_INVALID) {
+            return 1;
+        }
 
-    auto sheet = ivan_g->restoreMap(*elena_g, '@', '&');
-    if (sheet.empty()) {
-        sheet = elena_g->restoreMap(*ivan_g, '&', '@');
-    }
-    if (sheet.empty()) {
-        std::cout << "Restore map error: This algorithm cannot restore map for this case" << std::endl;
+        std::ofstream output("output.txt");
+        output << moves << "XX" << std::endl;
+
+        const auto verdict = answer.verdict == VPF_VERDICT_MET ? game::Verdict::Met
+            : answer.verdict == VPF_VERDICT_CANNOT_MEET ? game::Verdict::CannotMeet
+            : game::Verdict::AlgorithmError;
+        auto result = game::Result(verdict, answer.turn_count, message);
+        result.map = map;
+        result.budget_hits = answer.budget_hits;
+        game::report(std::cout, result);
+        if (budget.isLimited()) {
+            std::cerr << "Budget hit: " << result.budget_hits << " searches" << std::endl;
+        }
+        if (memory_report) {
+            memory::report(std::cerr, ledger);
+        }
         awaiting_on_exit(!TEST_MODE);
         return 0;
     }
-    std::cout << std::endl << sheet << std::endl;
+
+    // Saved moves must be read before the world rewrites output.txt
+    checkpoint::Snapshot snapshot;
+    if (resume) {
+        snapshot = checkpoint::read(checkpoint_path, "output.txt");
+    }
+    const auto world = std::make_shared<Fairyland>();
+    checkpoint::Writer writer(checkpoint_path, checkpoint_interval);
+    const auto result = checkpoint::play(world, writer, resume ? &snapshot : nullptr);
+    if (writer.hasFailed()) {
+        std::cerr << "Some snapshots could not be written to " << checkpoint_path << std::endl;
+    }
+    game::report(std::cout, result);
+    if (memory_report) {
+        memory::report(std::cerr, ledger);
+    }
     awaiting_on_exit(!TEST_MODE);
     return 0;
 }
@@ -0,0 +1,213 @@
+#include "memory.hpp"
+
+#include <cstdint>
+#include <ostream>
+
+namespace memory {
+    thread_local Ledger* gLedger = nullptr;
+
+    namespace {
+        /// @returns Name of the subsystem which is used by reports
+        const char* getSubsystemName(const size_t subsystem) noexcept
+        {
+            static const char* const gNames[] = { "other", "nodes", "search", "routes", "maps", "tiles", "total" };
+            return gNames[subsystem];
+        }
+
+        /// @returns Name of the phase which is used by reports
+        const char* getPhaseName(const size_t phase) noexcept
+        {
+            static const char* const gNames[] = { "explore", "rerun", "restore" };
+            return gNames[phase];
+        }
+
+        /// Writes usages which have any memory, the last usage is the total
+        void writeUsages(std::ostream& output, const Usage* usages, const size_t count)
+        {
+            for (size_t index = 0; index < count; ++index) {
+                const auto& usage = usages[index];
+                if (usage.allocations == 0 && usage.peak == 0) {
+                    continue;
+                }
+                output << "  " << getSubsystemName(index) << ": " << usage.allocations << " allocations, "
+                    << usage.bytes << " bytes, peak " << usage.peak << " bytes, live " << usage.live << " bytes"
+                    << std::endl;
+            }
+        }
+    }
+
+    /* Usage */
+
+    Usage::Usage() noexcept : allocations(0), bytes(0), live(0), peak(0)
+    {}
+
+    /* Ledger */
+
+    Ledger::Ledger() noexcept : m_phase(Phase::Explore)
+    {}
+
+    void Ledger::allocate(const Subsystem subsystem, const size_t bytes) noexcept
+    {
+        const auto phase = static_cast<size_t>(m_phase);
+        for (const auto index : { static_cast<size_t>(subsystem), gSubsystems }) {
+            auto& usage = m_usage[index];
+            usage.allocations += 1;
+            usage.bytes += bytes;
+            usage.live += bytes;
+            usage.peak = usage.live > usage.peak ? usage.live : usage.peak;
+
+            auto& phase_usage = m_phases[phase][index];
+            phase_usage.allocations += 1;
+            phase_usage.bytes += bytes;
+            follow(phase_usage, usage);
+        }
+    }
+
+    Phase Ledger::getPhase() const noexcept
+    {
+        return m_phase;
+    }
+
+    const Usage& Ledger::getTotal() const noexcept
+    {
+        return m_usage[gSubsystems];
+    }
+
+    const Usage& Ledger::getTotal(const Phase phase) const noexcept
+    {
+        return m_phases[static_cast<size_t>(phase)][gSubsystems];
+    }
+
+    const Usage& Ledger::getUsage(const Subsystem subsystem) const noexcept
+    {
+        return m_usage[static_cast<size_t>(subsystem)];
+    }
+
+    const Usage& Ledger::getUsage(const Phase phase, const Subsystem subsystem) const noexcept
+    {
+        return m_phases[static_cast<size_t>(phase)][static_cast<size_t>(subsystem)];
+    }
+
+    void Ledger::release(const Subsystem subsystem, const size_t bytes) noexcept
+    {
+        const auto phase = static_cast<size_t>(m_phase);
+        for (const auto index : { static_cast<size_t>(subsystem), gSubsystems }) {
+            auto& usage = m_usage[index];
+            usage.live = usage.live > bytes ? usage.live - bytes : 0;
+            follow(m_phases[phase][index], usage);
+        }
+    }
+
+    void Ledger::reset() noexcept
+    {
+        *this = Ledger();
+    }
+
+    void Ledger::setPhase(const Phase phase) noexcept
+    {
+        m_phase = phase;
+        for (size_t index = 0; index <= gSubsystems; ++index) {
+            follow(m_phases[static_cast<size_t>(phase)][index], m_usage[index]);
+        }
+    }
+
+    void Ledger::follow(Usage& phase, const Usage& run) noexcept
+    {
+        phase.live = run.live;
+        phase.peak = run.live > phase.peak ? run.live : phase.peak;
+    }
+
+    /* Accounting */
+
+    Accounting::Accounting(Ledger& ledger) noexcept : m_previous(gLedger)
+    {
+        gLedger = &ledger;
+    }
+
+    Accounting::~Accounting()
+    {
+        gLedger = m_previous;
+    }
+
+    /* Arena */
+
+    Arena::Arena(const size_t t_chunk_size) noexcept
+        : m_chunk_size(t_chunk_size), m_chunk(0), m_offset(0), m_heap_calls(0)
+    {}
+
+    Arena::~Arena()
+    {
+        for (const auto& chunk : m_chunks) {
+            ::operator delete(chunk.data);
+        }
+    }
+
+    void* Arena::allocate(const size_t size, const size_t alignment)
+    {
+        while (m_chunk < m_chunks.size()) {
+            const auto& chunk = m_chunks[m_chunk];
+            const auto address = reinterpret_cast<std::uintptr_t>(chunk.data) + m_offset;
+            const auto padding = (alignment - address % alignment) % alignment;
+            if (m_offset + padding + size <= chunk.size) {
+                m_offset += padding + size;
+                return chunk.data + m_offset - size;
+            }
+            // The rest of the chunk is lost until the reset
+            m_chunk += 1;
+            m_offset = 0;
+        }
+
+        // Chunk memory from operator new is aligned for any fundamental type
+        const auto chunk_size = size > m_chunk_size ? size : m_chunk_size;
+        m_chunks.push_back(Chunk{ static_cast<char*>(::operator new(chunk_size)), chunk_size });
+        m_heap_calls += 1;
+        m_chunk = m_chunks.size() - 1;
+        m_offset = size;
+        return m_chunks.back().data;
+    }
+
+    size_t Arena::getCapacity() const noexcept
+    {
+        size_t capacity = 0;
+        for (const auto& chunk : m_chunks) {
+            capacity += chunk.size;
+        }
+        return capacity;
+    }
+
+    size_t Arena::getHeapCalls() const noexcept
+    {
+        return m_heap_calls;
+    }
+
+    void Arena::reset() noexcept
+    {
+        m_chunk = 0;
+        m_offset = 0;
+    }
+
+    /* Functions */
+
+    void report(std::ostream& output, const Ledger& ledger)
+    {
+        Usage usages[static_cast<size_t>(Subsystem::Count) + 1];
+        for (size_t index = 0; index < static_cast<size_t>(Subsystem::Count); ++index) {
+            usages[index] = ledger.getUsage(static_cast<Subsystem>(index));
+        }
+        usages[static_cast<size_t>(Subsystem::Count)] = ledger.getTotal();
+        output << "Memory of the run:" << std::endl;
+        writeUsages(output, usages, static_cast<size_t>(Subsystem::Count) + 1);
+
+        for (size_t phase = 0; phase < static_cast<size_t>(Phase::Count); ++phase) {
+            if (ledger.getTotal(static_cast<Phase>(phase)).peak == 0) {
+                continue;
+            }
+            for (size_t index = 0; index < static_cast<size_t>(Subsystem::Count); ++index) {
+                usages[index] = ledger.getUsage(static_cast<Phase>(phase), static_cast<Subsystem>(index));
+            }
+            usages[static_cast<size_t>(Subsystem::Count)] = ledger.getTotal(static_cast<Phase>(phase));
+            output << "Memory of the " << getPhaseName(phase) << " phase:" << std::endl;
+            writeUsages(output, usages, static_cast<size_t>(Subsystem::Count) + 1);
+        }
+    }
+}
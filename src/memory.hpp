@@ -0,0 +1,242 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+namespace memory {
+    /// Represents the part of the solver which owns the memory (see memory::Ledger)
+    enum class Subsystem {
+        Other,   //!< Memory which is not tagged
+        Nodes,   //!< Graph nodes with their list and index
+        Search,  //!< Buffers of searches for unvisited nodes
+        Routes,  //!< Steps of advice routes
+        Maps,    //!< Restored maps and buffers which are used to restore them
+        Tiles,   //!< Cold nodes of graphs which are compacted into tiles (see graph::Graph::setTiering)
+        Count,
+    };
+
+    /// Represents the step of the game which allocations are accounted to
+    enum class Phase {
+        Explore,  //!< Pals explore the labyrinth
+        Rerun,    //!< Ivan reruns the explored labyrinth
+        Restore,  //!< The map is restored after pals had met
+        Count,
+    };
+
+    /// Represents the memory usage of one subsystem
+    struct Usage {
+        size_t allocations;  //!< Amount of allocations
+        size_t bytes;        //!< Bytes of all allocations
+        size_t live;         //!< Bytes which are not released yet
+        size_t peak;         //!< The highest amount of live bytes
+
+        Usage() noexcept;
+    };
+
+    /// Accounts the memory of one run by subsystems and phases. Accounting is opt-in: only the thread which
+    /// installed the ledger by memory::Accounting is accounted, others pay one check per allocation. Arena memory
+    /// is accounted when it is given to containers and released by them, not when chunks are requested
+    class Ledger {
+    public:
+        Ledger() noexcept;
+
+    public:
+        /// Accounts the allocation of the subsystem in the current phase
+        void allocate(const Subsystem subsystem, const size_t bytes) noexcept;
+
+        /// @returns Phase which allocations are accounted to
+        Phase getPhase() const noexcept;
+
+        /// @returns Usage of all subsystems since the ledger was created or reset
+        const Usage& getTotal() const noexcept;
+
+        /// @returns Usage of all subsystems during the phase (see the phase version of Ledger::getUsage)
+        const Usage& getTotal(const Phase phase) const noexcept;
+
+        /// @returns Usage of the subsystem since the ledger was created or reset
+        const Usage& getUsage(const Subsystem subsystem) const noexcept;
+
+        /// @returns Usage of the subsystem during the phase: allocations and bytes which were made in the phase,
+        /// the highest amount of live bytes during the phase and live bytes at its end
+        const Usage& getUsage(const Phase phase, const Subsystem subsystem) const noexcept;
+
+        /// Accounts the release of the memory. Memory which was allocated before the ledger was installed is
+        /// never counted below zero
+        void release(const Subsystem subsystem, const size_t bytes) noexcept;
+
+        /// Forgets all usage, so the ledger accounts the next run from the Phase::Explore
+        void reset() noexcept;
+
+        /// Makes the phase current. Memory which is still live is taken into its usage
+        void setPhase(const Phase phase) noexcept;
+
+    private:
+        static const size_t gSubsystems = static_cast<size_t>(Subsystem::Count);
+        static const size_t gPhases = static_cast<size_t>(Phase::Count);
+
+        /// Updates the phase usage by the live bytes of the whole run
+        static void follow(Usage& phase, const Usage& run) noexcept;
+
+        Phase m_phase;
+        Usage m_usage[gSubsystems + 1];  //!< Usage of every subsystem and the total at the end
+        Usage m_phases[gPhases][gSubsystems + 1];
+    };
+
+    /// Installs the ledger for the calling thread while the object lives. The previous ledger is installed back
+    /// when the object is destroyed
+    class Accounting {
+    public:
+        explicit Accounting(Ledger& ledger) noexcept;
+        Accounting(const Accounting&) = delete;
+        Accounting& operator = (const Accounting&) = delete;
+        ~Accounting();
+
+    private:
+        Ledger* m_previous;
+    };
+
+    /// Ledger of the calling thread or nullptr when its memory is not accounted (see memory::Accounting)
+    extern thread_local Ledger* gLedger;
+
+    /// Accounts the allocation by the ledger of the calling thread if there is one
+    inline void countAllocation(const Subsystem subsystem, const size_t bytes) noexcept
+    {
+        if (gLedger != nullptr) {
+            gLedger->allocate(subsystem, bytes);
+        }
+    }
+
+    /// Accounts the release by the ledger of the calling thread if there is one
+    inline void countRelease(const Subsystem subsystem, const size_t bytes) noexcept
+    {
+        if (gLedger != nullptr) {
+            gLedger->release(subsystem, bytes);
+        }
+    }
+
+    /// Makes the phase current in the ledger of the calling thread if there is one
+    inline void setPhase(const Phase phase) noexcept
+    {
+        if (gLedger != nullptr) {
+            gLedger->setPhase(phase);
+        }
+    }
+
+    /// Writes usage of every subsystem for the whole run and for every phase. Subsystems without memory are skipped
+    void report(std::ostream& output, const Ledger& ledger);
+
+    /// Represents the monotonic memory resource of one run. Memory is given from big chunks and is never freed
+    /// separately, so the whole run is released by Arena::reset in O(1). Chunks are kept after the reset, so the next
+    /// run of the same or smaller labyrinth makes no calls to the global heap
+    class Arena {
+    public:
+        /// @param t_chunk_size Size of the chunk which is requested from the global heap when the arena is full
+        explicit Arena(const size_t t_chunk_size = 64 * 1024) noexcept;
+        Arena(const Arena&) = delete;
+        Arena& operator = (const Arena&) = delete;
+        ~Arena();
+
+    public:
+        /// @returns Aligned memory of the indicated size which lives until the next Arena::reset
+        ///
+        /// @throws std::bad_alloc when the global heap cannot give a new chunk
+        void* allocate(const size_t size, const size_t alignment);
+
+        /// @returns Total size of chunks which are owned by the arena
+        size_t getCapacity() const noexcept;
+
+        /// @returns Amount of chunks which were requested from the global heap since the arena was created
+        size_t getHeapCalls() const noexcept;
+
+        /// Makes all memory of the arena free again. All objects which use the arena must be destroyed before
+        void reset() noexcept;
+
+    private:
+        struct Chunk {
+            char* data;
+            size_t size;
+        };
+
+        size_t m_chunk_size;
+        std::vector<Chunk> m_chunks;
+        size_t m_chunk;   //!< Index of the chunk which gives memory right now
+        size_t m_offset;  //!< Offset of the free memory in the current chunk
+        size_t m_heap_calls;
+    };
+
+    /// Represents the standard allocator which takes memory from the arena. The allocator without arena uses
+    /// the global heap, so containers which are created out of the run work as usual. Memory is accounted to
+    /// the subsystem of the allocator (see memory::Ledger)
+    template <typename T>
+    class ArenaAllocator {
+    public:
+        using value_type = T;
+        // Allocator follows the container, so moved or copied containers keep memory of their arena
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+
+        ArenaAllocator(Arena* t_arena = nullptr, const Subsystem t_subsystem = Subsystem::Other) noexcept
+            : m_arena(t_arena), m_subsystem(t_subsystem)
+        {}
+
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+            : m_arena(other.getArena()), m_subsystem(other.getSubsystem())
+        {}
+
+    public:
+        T* allocate(const size_t count)
+        {
+            const auto pointer = m_arena == nullptr
+                ? ::operator new(count * sizeof(T))
+                : m_arena->allocate(count * sizeof(T), alignof(T));
+            countAllocation(m_subsystem, count * sizeof(T));
+            return static_cast<T*>(pointer);
+        }
+
+        /// Arena memory is released only by Arena::reset
+        void deallocate(T* pointer, const size_t count) noexcept
+        {
+            countRelease(m_subsystem, count * sizeof(T));
+            if (m_arena == nullptr) {
+                ::operator delete(pointer);
+            }
+        }
+
+        /// @returns Arena of the allocator or nullptr when the global heap is used
+        Arena* getArena() const noexcept
+        {
+            return m_arena;
+        }
+
+        /// @returns Subsystem which memory of the allocator is accounted to
+        Subsystem getSubsystem() const noexcept
+        {
+            return m_subsystem;
+        }
+
+    private:
+        Arena* m_arena;
+        Subsystem m_subsystem;
+    };
+
+    template <typename T, typename U>
+    bool operator == (const ArenaAllocator<T>& first, const ArenaAllocator<U>& second) noexcept
+    {
+        return first.getArena() == second.getArena();
+    }
+
+    template <typename T, typename U>
+    bool operator != (const ArenaAllocator<T>& first, const ArenaAllocator<U>& second) noexcept
+    {
+        return !(first == second);
+    }
+
+    /// Vector which keeps elements in the arena
+    template <typename T>
+    using Vector = std::vector<T, ArenaAllocator<T>>;
+}
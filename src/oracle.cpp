@@ -0,0 +1,234 @@
+#include "fairy_tail.hpp"
+#include "oracle.hpp"
+
+#include <bitset>
+
+namespace oracle {
+    /* Bitmap */
+
+    Bitmap::Bitmap(const int t_width, const int t_height) noexcept
+        : m_width(t_width),
+        m_height(t_height),
+        m_row_words((t_width + 63) / 64),
+        m_words(static_cast<size_t>((t_width + 63) / 64 * t_height), 0)
+    {}
+
+    bool Bitmap::any() const noexcept
+    {
+        for (const auto word : m_words) {
+            if (word != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t Bitmap::count() const noexcept
+    {
+        size_t count = 0;
+        for (const auto word : m_words) {
+            count += std::bitset<64>(word).count();
+        }
+        return count;
+    }
+
+    bool Bitmap::first(int& x, int& y) const noexcept
+    {
+        for (size_t index = 0; index < m_words.size(); ++index) {
+            const auto word = m_words[index];
+            if (word == 0) {
+                continue;
+            }
+            const auto bit = static_cast<int>(std::bitset<64>((word & (~word + 1)) - 1).count());
+            y = static_cast<int>(index) / m_row_words;
+            x = static_cast<int>(index) % m_row_words * 64 + bit;
+            return true;
+        }
+        return false;
+    }
+
+    std::vector<std::pair<int, int>> Bitmap::getShape() const noexcept
+    {
+        std::vector<std::pair<int, int>> shape;
+        int first_x = 0;
+        int first_y = 0;
+        if (!first(first_x, first_y)) {
+            return shape;
+        }
+
+        shape.reserve(count());
+        for (int y = first_y; y < m_height; ++y) {
+            for (int x = 0; x < m_width; ++x) {
+                if (test(x, y)) {
+                    shape.emplace_back(x - first_x, y - first_y);
+                }
+            }
+        }
+        return shape;
+    }
+
+    Bitmap Bitmap::grow(const Bitmap& mask) const noexcept
+    {
+        Bitmap bitmap(m_width, m_height);
+        for (int y = 0; y < m_height; ++y) {
+            for (int word = 0; word < m_row_words; ++word) {
+                const auto index = y * m_row_words + word;
+                const auto cells = m_words[index];
+
+                // Horizontal neighbors with carry between words of the row
+                auto grown = cells | (cells << 1) | (cells >> 1);
+                if (word > 0) {
+                    grown |= m_words[index - 1] >> 63;
+                }
+                if (word + 1 < m_row_words) {
+                    grown |= m_words[index + 1] << 63;
+                }
+
+                // Vertical neighbors
+                if (y > 0) {
+                    grown |= m_words[index - m_row_words];
+                }
+                if (y + 1 < m_height) {
+                    grown |= m_words[index + m_row_words];
+                }
+
+                // Padding bits of the row are never set in the mask
+                bitmap.m_words[index] = grown & mask.m_words[index];
+            }
+        }
+        return bitmap;
+    }
+
+    void Bitmap::set(const int x, const int y) noexcept
+    {
+        m_words[y * m_row_words + x / 64] |= std::uint64_t(1) << (x % 64);
+    }
+
+    bool Bitmap::test(const int x, const int y) const noexcept
+    {
+        return ((m_words[y * m_row_words + x / 64] >> (x % 64)) & 1) != 0;
+    }
+
+    Bitmap Bitmap::without(const Bitmap& other) const noexcept
+    {
+        Bitmap bitmap(m_width, m_height);
+        for (size_t index = 0; index < m_words.size(); ++index) {
+            bitmap.m_words[index] = m_words[index] & ~other.m_words[index];
+        }
+        return bitmap;
+    }
+
+    bool Bitmap::operator == (const Bitmap& other) const noexcept
+    {
+        return m_words == other.m_words;
+    }
+
+    bool Bitmap::operator != (const Bitmap& other) const noexcept
+    {
+        return !(*this == other);
+    }
+
+    /* Report */
+
+    Report::Report() noexcept
+        : components(0),
+        ivan_component(0),
+        elena_component(0),
+        can_meet(false),
+        distance(-1),
+        meeting_time(-1),
+        mirror_ambiguous(false)
+    {}
+
+    /* Functions */
+
+    Bitmap getPassages(const Fairyland& world) noexcept
+    {
+        const auto width = static_cast<int>(world.getWidth());
+        const auto height = static_cast<int>(world.getHeight());
+
+        Bitmap passages(width, height);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                if (world.isPassage(x, y)) {
+                    passages.set(x, y);
+                }
+            }
+        }
+        return passages;
+    }
+
+    std::vector<Bitmap> findComponents(const Fairyland& world) noexcept
+    {
+        const auto passages = getPassages(world);
+
+        std::vector<Bitmap> components;
+        auto remaining = passages;
+        int x = 0;
+        int y = 0;
+        while (remaining.first(x, y)) {
+            Bitmap component(static_cast<int>(world.getWidth()), static_cast<int>(world.getHeight()));
+            component.set(x, y);
+            for (auto grown = component.grow(passages); grown != component; grown = component.grow(passages)) {
+                component = grown;
+            }
+            remaining = remaining.without(component);
+            components.push_back(component);
+        }
+        return components;
+    }
+
+    Report solve(const Fairyland& world) noexcept
+    {
+        Report report;
+
+        const auto ivan = world.getPosition(Character::Ivan);
+        const auto elena = world.getPosition(Character::Elena);
+
+        const auto components = findComponents(world);
+        report.components = components.size();
+
+        size_t ivan_index = 0;
+        size_t elena_index = 0;
+        for (size_t index = 0; index < components.size(); ++index) {
+            if (components[index].test(ivan.first, ivan.second)) {
+                ivan_index = index;
+            }
+            if (components[index].test(elena.first, elena.second)) {
+                elena_index = index;
+            }
+        }
+        report.ivan_component = components[ivan_index].count();
+        report.elena_component = components[elena_index].count();
+        report.can_meet = ivan_index == elena_index;
+
+        if (report.can_meet) {
+            // Every pass grows the front by one step, so the pass which reaches Elena gives the distance.
+            // Pals move towards each other and can meet passing through each other, so the half is enough
+            const auto passages = getPassages(world);
+            Bitmap front(static_cast<int>(world.getWidth()), static_cast<int>(world.getHeight()));
+            front.set(ivan.first, ivan.second);
+            report.distance = 0;
+            while (!front.test(elena.first, elena.second)) {
+                front = front.grow(passages);
+                report.distance += 1;
+            }
+            report.meeting_time = (report.distance + 1) / 2;
+        }
+
+        // Translated copy can be only a component of the same size
+        const auto has_copy = [&components](const size_t component) {
+            const auto shape = components[component].getShape();
+            for (size_t index = 0; index < components.size(); ++index) {
+                if (index != component
+                    && components[index].count() == shape.size()
+                    && components[index].getShape() == shape) {
+                    return true;
+                }
+            }
+            return false;
+        };
+        report.mirror_ambiguous = has_copy(ivan_index) || (elena_index != ivan_index && has_copy(elena_index));
+        return report;
+    }
+}
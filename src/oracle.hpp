@@ -0,0 +1,79 @@
+#pragma once
+
+#include "fairy_tail.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace oracle {
+    /// Represents the set of labyrinth cells as rows of 64-bit words. Every operation processes 64 cells at once,
+    /// so flood fill advances the whole front of the component by one step per pass over the words
+    class Bitmap {
+    public:
+        Bitmap(const int t_width, const int t_height) noexcept;
+
+    public:
+        /// @returns True if any cell is set
+        bool any() const noexcept;
+
+        /// @returns Amount of set cells
+        size_t count() const noexcept;
+
+        /// Finds the first set cell in row-major order
+        ///
+        /// @returns False when the bitmap is empty. In that case x and y are not changed
+        bool first(int& x, int& y) const noexcept;
+
+        /// @returns Positions of set cells relative to the first one in row-major order. Equal shapes mean that
+        /// bitmaps are translated copies of each other
+        std::vector<std::pair<int, int>> getShape() const noexcept;
+
+        /// @returns Cells of this bitmap with all their neighbors which are also set in the mask
+        Bitmap grow(const Bitmap& mask) const noexcept;
+
+        /// Sets the cell at (x; y)
+        void set(const int x, const int y) noexcept;
+
+        /// @returns True if the cell at (x; y) is set
+        bool test(const int x, const int y) const noexcept;
+
+        /// @returns Cells of this bitmap which are not set in the other
+        Bitmap without(const Bitmap& other) const noexcept;
+
+        bool operator == (const Bitmap& other) const noexcept;
+        bool operator != (const Bitmap& other) const noexcept;
+
+    private:
+        int m_width;
+        int m_height;
+        int m_row_words;
+        std::vector<std::uint64_t> m_words;
+    };
+
+    /// Represents ground truth answers for the labyrinth which are computed without simulating the game
+    struct Report {
+        size_t components;           //!< Amount of connected components of passages
+        size_t ivan_component;       //!< Amount of cells in Ivan's component
+        size_t elena_component;      //!< Amount of cells in Elena's component
+        bool can_meet;               //!< True when Ivan and Elena share the component
+        int distance;                //!< Length of the shortest path between pals or -1 when they cannot meet
+        int meeting_time;            //!< Least amount of turns to meet when both move or -1 when they cannot meet
+        bool mirror_ambiguous;       //!< True when another component is a translated copy of pals' component,
+                                     //!< so explored graphs alone cannot tell which copy pals are in
+
+        Report() noexcept;
+    };
+
+    /// @returns Bitmap of all passages of the world labyrinth
+    Bitmap getPassages(const Fairyland& world) noexcept;
+
+    /// Labels connected components of the labyrinth using bitmap flood fill
+    ///
+    /// @returns Bitmap for every component in row-major order of their first cells
+    std::vector<Bitmap> findComponents(const Fairyland& world) noexcept;
+
+    /// Computes ground truth answers for the start positions of the world. Must be used before the world is played
+    Report solve(const Fairyland& world) noexcept;
+}
@@ -0,0 +1,28 @@
+#include "fairy_tail.hpp"
+#include "oracle.hpp"
+
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char** argv)
+{
+    // Usage: Volga-IT-Pathfinder-Oracle [input.txt]
+    const char* path = argc > 1 ? argv[1] : "input.txt";
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "File " << path << " not found" << std::endl;
+        return 1;
+    }
+
+    const Fairyland world(file);
+    const auto report = oracle::solve(world);
+
+    std::cout << "Components: " << report.components << std::endl;
+    std::cout << "Ivan's component: " << report.ivan_component << std::endl;
+    std::cout << "Elena's component: " << report.elena_component << std::endl;
+    std::cout << "Can meet: " << (report.can_meet ? "yes" : "no") << std::endl;
+    std::cout << "Distance: " << report.distance << std::endl;
+    std::cout << "Meeting time: " << report.meeting_time << std::endl;
+    std::cout << "Mirror ambiguous: " << (report.mirror_ambiguous ? "yes" : "no") << std::endl;
+    return 0;
+}
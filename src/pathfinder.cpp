@@ -2,6 +2,8 @@
 #include "graph.hpp"
 #include "pathfinder.hpp"
 
+#include <utility>
+
 namespace pathfinder {
     /* Funtions */
 
@@ -52,22 +54,66 @@ namespace pathfinder {
 
     AdviceRoute::AdviceRoute(const Direction t_world, const graph::Direction t_graph) noexcept : world(t_world), graph(t_graph) {}
 
-    /* Advice */
+    /* AdviceRoutes */
+
+    AdviceRoutes::Iterator::Iterator(const graph::Route::Iterator t_iterator) noexcept : m_iterator(t_iterator) {}
 
-    Advice::Advice(const AdviceType t_type, const std::vector<graph::Direction>& t_route) noexcept : type(t_type)
+    AdviceRoute AdviceRoutes::Iterator::operator * () const noexcept
     {
-        route = std::vector<AdviceRoute>();
-        route.reserve(t_route.size());
-        for (const auto& direction : t_route) {
-            route.push_back(AdviceRoute(directionToDirection(direction), direction));
-        }
+        const auto direction = *m_iterator;
+        return AdviceRoute(directionToDirection(direction), direction);
+    }
+
+    AdviceRoutes::Iterator& AdviceRoutes::Iterator::operator ++ () noexcept
+    {
+        ++m_iterator;
+        return *this;
+    }
+
+    bool AdviceRoutes::Iterator::operator != (const Iterator& other) const noexcept
+    {
+        return m_iterator != other.m_iterator;
+    }
+
+    AdviceRoutes::AdviceRoutes(graph::Route t_route) noexcept : m_route(std::move(t_route)) {}
+
+    AdviceRoutes::Iterator AdviceRoutes::begin() const noexcept
+    {
+        return Iterator(m_route.begin());
+    }
+
+    AdviceRoutes::Iterator AdviceRoutes::end() const noexcept
+    {
+        return Iterator(m_route.end());
+    }
+
+    bool AdviceRoutes::empty() const noexcept
+    {
+        return m_route.empty();
+    }
+
+    size_t AdviceRoutes::size() const noexcept
+    {
+        return m_route.size();
+    }
+
+    AdviceRoute AdviceRoutes::operator [] (const size_t index) const noexcept
+    {
+        const auto direction = m_route[index];
+        return AdviceRoute(directionToDirection(direction), direction);
     }
 
+    /* Advice */
+
+    Advice::Advice(const AdviceType t_type, graph::Route t_route) noexcept
+        : type(t_type), route(std::move(t_route))
+    {}
+
     Advice::Advice(const AdviceType t_type, const std::initializer_list<graph::Direction>& t_route) noexcept
-        : Advice(t_type, std::vector<graph::Direction>(t_route))
+        : Advice(t_type, graph::Route(t_route))
     {}
 
-    Advice::Advice(const AdviceType t_type) noexcept : Advice(t_type, {}) {}
+    Advice::Advice(const AdviceType t_type) noexcept : Advice(t_type, graph::Route()) {}
 
     /* Pathfinder */
 
@@ -75,9 +121,21 @@ namespace pathfinder {
         const std::shared_ptr<Fairyland> t_world,
         const Character t_char,
         const std::shared_ptr<graph::Graph> t_graph) noexcept
-        : m_world(t_world), m_character(t_char), m_graph(t_graph)
+        : Pathfinder(t_world, static_cast<size_t>(t_char), t_graph)
     {}
 
+    Pathfinder::Pathfinder(
+        const std::shared_ptr<Fairyland> t_world,
+        const size_t t_agent,
+        const std::shared_ptr<graph::Graph> t_graph) noexcept
+        : m_world(t_world), m_graph(t_graph), m_agent(t_agent)
+    {}
+
+    bool Pathfinder::deadendCheck() const noexcept
+    {
+        return m_graph->getCurrent().lock()->deadendCheck();
+    }
+
     Advice Pathfinder::getAdvice() const noexcept
     {
         // For meeting in the labyrinth only one plan exists:
@@ -124,18 +182,52 @@ namespace pathfinder {
 
         // VISIT UNVISITED ADVICE
         if (!m_graph->isExplored()) {
-            const auto route = m_graph->findUnvisitedNode();
+            auto route = m_graph->findUnvisitedNode();
             if (!route.empty()) {
-                return Advice(AdviceType::Move, route);
+                return Advice(AdviceType::Move, std::move(route));
+            }
+            // The search is over the budget, so the pal stays while it is resumed
+            if (m_graph->isSearching()) {
+                return Advice(AdviceType::Wait);
             }
         }
 
         return Advice(AdviceType::Rendezvous);
     }
 
+    size_t Pathfinder::getAgent() const noexcept
+    {
+        return m_agent;
+    }
+
+    std::uint64_t Pathfinder::getBudgetHits() const noexcept
+    {
+        return m_graph->getBudgetHits();
+    }
+
     inline Character Pathfinder::getCharacter() const noexcept
     {
-        return m_character;
+        return m_agent == 0 ? Character::Ivan : Character::Elena;
+    }
+
+    std::uint64_t Pathfinder::getExpansions() const noexcept
+    {
+        return m_graph->getExpansions();
+    }
+
+    std::uint64_t Pathfinder::getFingerprint() const noexcept
+    {
+        return m_graph->getFingerprint();
+    }
+
+    size_t Pathfinder::getNodeCount() const noexcept
+    {
+        return m_graph->getNodeCount();
+    }
+
+    graph::Rectangle Pathfinder::getRectangle() const noexcept
+    {
+        return m_graph->getRectangle();
     }
 
     inline std::shared_ptr<Fairyland> Pathfinder::getWorld() const noexcept
@@ -144,25 +236,85 @@ namespace pathfinder {
     }
     
     void Pathfinder::go(const graph::Direction direction) const noexcept
+    {
+        go(direction, m_world->getOpenMask(m_agent));
+    }
+
+    void Pathfinder::go(const graph::Direction direction, const unsigned char mask) const noexcept
     {
         m_graph->go(direction);
-        updateNode();
+        updateNode(mask);
         m_graph->getCurrent().lock()->deadendCheck();
     }
 
-    void Pathfinder::updateNode() const noexcept
+    bool Pathfinder::isAlignable(
+        const Pathfinder& pathfinder,
+        const graph::Rectangle& deltas,
+        graph::Position& delta) const noexcept
     {
-        const auto directions = {
-            graph::Direction::Left,
-            graph::Direction::Right,
-            graph::Direction::Up,
-            graph::Direction::Down
-        };
+        return m_graph->isAlignable(*pathfinder.m_graph, deltas, delta);
+    }
 
-        for (const auto& direction : directions) {
-            if (m_world->canGo(m_character, directionToDirection(direction))) {
-                m_graph->createNodeAt(direction);
-            }
+    bool Pathfinder::isExplored() const noexcept
+    {
+        return m_graph->isExplored();
+    }
+
+    void Pathfinder::load(std::istream& input) const
+    {
+        m_graph->load(input);
+    }
+
+    bool Pathfinder::merge(const Pathfinder& pathfinder, const int width, const int height) const noexcept
+    {
+        if (!m_graph->alignWith(*pathfinder.m_graph, width, height)) {
+            return false;
         }
+        m_graph->merge(*pathfinder.m_graph);
+        return true;
+    }
+
+    void Pathfinder::rerun() const noexcept
+    {
+        m_graph->setBounds(0, 0);
+        m_graph->resetDeadendNodes();
+        m_graph->resetVisitedNodes();
+        m_graph->getCurrent().lock()->deadendCheck();
+    }
+
+    std::string Pathfinder::restoreMap(
+        const Pathfinder& pathfinder,
+        const char this_start,
+        const char other_start,
+        const int width,
+        const int height) const noexcept
+    {
+        return m_graph->restoreMap(*pathfinder.m_graph, this_start, other_start, width, height);
+    }
+
+    void Pathfinder::save(std::ostream& output) const
+    {
+        m_graph->save(output);
+    }
+
+    void Pathfinder::setBounds(const int width, const int height) const noexcept
+    {
+        m_graph->setBounds(width, height);
+    }
+
+    void Pathfinder::setBudget(const graph::Budget& budget) const noexcept
+    {
+        m_graph->setBudget(budget);
+    }
+
+    void Pathfinder::updateNode() const noexcept
+    {
+        updateNode(m_world->getOpenMask(m_agent));
+    }
+
+    void Pathfinder::updateNode(const unsigned char mask) const noexcept
+    {
+        m_graph->createNodesAt(mask);
+        m_graph->pruneFrontier();
     }
 }
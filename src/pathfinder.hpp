@@ -2,8 +2,12 @@
 
 #include "graph.hpp"
 
+#include <cstdint>
+#include <initializer_list>
+#include <istream>
 #include <memory>
-#include <vector>
+#include <ostream>
+#include <string>
 
 namespace pathfinder {
     struct AdviceRoute; // Predefines
@@ -42,6 +46,7 @@ namespace pathfinder {
     enum class AdviceType {
         Move,        //!< Used with non-empty AdviceRoute
         Rendezvous,  //!< Used when the labyrinth is explored and you ready to meet you friend.
+        Wait,        //!< Used when the search is paused by the budget. The next advice resumes it
     };
 
     /// Represents directions relative to the world and to the graph which must be applied to reach some neighbor node
@@ -52,12 +57,48 @@ namespace pathfinder {
         AdviceRoute(const Direction t_world, const graph::Direction graph) noexcept;
     };
 
+    /// Represents the route of the advice. Keeps only packed graph directions and yields every step as AdviceRoute
+    /// with both world and graph directions
+    class AdviceRoutes {
+    public:
+        /// Iterates steps of the route in order
+        class Iterator {
+        public:
+            Iterator(const graph::Route::Iterator t_iterator) noexcept;
+
+            AdviceRoute operator * () const noexcept;
+            Iterator& operator ++ () noexcept;
+            bool operator != (const Iterator& other) const noexcept;
+
+        private:
+            graph::Route::Iterator m_iterator;
+        };
+
+        AdviceRoutes(graph::Route t_route) noexcept;
+
+    public:
+        Iterator begin() const noexcept;
+        Iterator end() const noexcept;
+
+        /// @returns True if the route has no steps
+        bool empty() const noexcept;
+
+        /// @returns Amount of steps
+        size_t size() const noexcept;
+
+        /// @returns The step at the index
+        AdviceRoute operator [] (const size_t index) const noexcept;
+
+    private:
+        graph::Route m_route;
+    };
+
     /// Represent given advice by Pathfinder::getAdvice method
     struct Advice {
-        AdviceType type;                 //!< Type of given advice
-        std::vector<AdviceRoute> route;  //!< Optional route, that can be empty but will be initialized
+        AdviceType type;     //!< Type of given advice
+        AdviceRoutes route;  //!< Optional route, that can be empty but will be initialized
 
-        Advice(const AdviceType t_type, const std::vector<graph::Direction>& t_route) noexcept;
+        Advice(const AdviceType t_type, graph::Route t_route) noexcept;
         Advice(const AdviceType t_type, const std::initializer_list<graph::Direction>& t_route) noexcept;
         Advice(const AdviceType t_type) noexcept;
     };
@@ -70,15 +111,41 @@ namespace pathfinder {
         /// @param t_graph A graph with the initialized start node of this person
         Pathfinder(const std::shared_ptr<Fairyland> t_world, const Character t_char, const std::shared_ptr<graph::Graph> t_graph) noexcept;
 
+        /// @param t_world Fairyland shared pointer to the world
+        /// @param t_agent Index of the world agent who uses this pathfinder. Ivan is 0 and Elena is 1
+        /// @param t_graph A graph with the initialized start node of this agent
+        Pathfinder(const std::shared_ptr<Fairyland> t_world, const size_t t_agent, const std::shared_ptr<graph::Graph> t_graph) noexcept;
+
     public:
+        /// Checks if the current node is a deadend using Node::deadendCheck
+        bool deadendCheck() const noexcept;
+
         /// Gives an advice. For full algorinth check source code
         /// 
         /// @returns An advice according to current situation in the labyrinth
         Advice getAdvice() const noexcept;
 
+        /// @returns Index of the world agent who uses this pathfinder
+        size_t getAgent() const noexcept;
+
+        /// @returns Amount of searches which were paused by the budget. See Graph::getBudgetHits
+        std::uint64_t getBudgetHits() const noexcept;
+
         /// @returns A fairytail character which used this pathfinder to reach pal
         inline Character getCharacter() const noexcept;
 
+        /// @returns Amount of nodes which were expanded by searches of the pal's graph. See Graph::getExpansions
+        std::uint64_t getExpansions() const noexcept;
+
+        /// @returns Translation-invariant hash of the pal's graph. See Graph::getFingerprint
+        std::uint64_t getFingerprint() const noexcept;
+
+        /// @returns Amount of known nodes of the pal's graph
+        size_t getNodeCount() const noexcept;
+
+        /// @returns Rectangle of the pal's graph
+        graph::Rectangle getRectangle() const noexcept;
+
         /// @returns A fairytail world where person tries to find the pal
         inline std::shared_ptr<Fairyland> getWorld() const noexcept;
 
@@ -86,13 +153,62 @@ namespace pathfinder {
         /// the movePals function
         void go(const graph::Direction direction) const noexcept;
 
-        /// Updates node using Graph::createNodeAt and Fairyland::canGo. Must be used after every pals move.
+        /// Moves the pal in the indicated direction in the graph and updates node using already sensed open
+        /// directions of the new pal's cell
+        void go(const graph::Direction direction, const unsigned char mask) const noexcept;
+
+        /// Checks if graphs of this and another pathfinder can lay in one labyrinth. See Graph::isAlignable
+        bool isAlignable(
+            const Pathfinder& pathfinder,
+            const graph::Rectangle& deltas,
+            graph::Position& delta) const noexcept;
+
+        /// Checks if all nodes of the pal's graph are visited
+        bool isExplored() const noexcept;
+
+        /// Replaces the pal's graph with the graph written by Pathfinder::save
+        ///
+        /// @throws std::runtime_error when data is corrupted
+        void load(std::istream& input) const;
+
+        /// Aligns graphs of this and another pathfinder after the meeting and adds nodes of another graph to this
+        /// one (see Graph::merge), so the joint map can be navigated as one graph
+        ///
+        /// @returns False when graphs cannot be aligned. In that case this graph is not changed
+        bool merge(const Pathfinder& pathfinder, const int width, const int height) const noexcept;
+
+        /// Resets deadend and visited nodes of the pal's graph for rerunning the labyrinth. Bounds inference is
+        /// disabled, so every node is visited again
+        void rerun() const noexcept;
+
+        /// Restores the map using graphs of this and another pathfinder. See Graph::restoreMap
+        std::string restoreMap(
+            const Pathfinder& pathfinder,
+            const char this_start,
+            const char other_start,
+            const int width,
+            const int height) const noexcept;
+
+        /// Writes the pal's graph. See Graph::save
+        void save(std::ostream& output) const;
+
+        /// Sets size of the labyrinth for the bounds inference of the pal's graph. See Graph::setBounds
+        void setBounds(const int width, const int height) const noexcept;
+
+        /// Sets the limit of every search for unvisited nodes. See Graph::setBudget
+        void setBudget(const graph::Budget& budget) const noexcept;
+
+        /// Updates node using Graph::createNodesAt and Fairyland::getOpenMask. Must be used after every pals move.
         /// Normally must be used through the Pathfinder::go method
         void updateNode() const noexcept;
 
+        /// Updates node using Graph::createNodesAt and already sensed open directions of the pal's cell. Then prunes
+        /// the frontier using Graph::pruneFrontier
+        void updateNode(const unsigned char mask) const noexcept;
+
     private:
         std::shared_ptr<Fairyland> m_world;     //!< A shared pointer to the world (world must be same with the pal)
         std::shared_ptr<graph::Graph> m_graph;  //!< An unique graph of the labyrinth (both must have different graphs)
-        Character m_character;                  //!< The character who relative to which the labyrinth being explored
+        size_t m_agent;                         //!< The agent who relative to which the labyrinth being explored
     };
 }
@@ -0,0 +1,246 @@
+#include "fairy_tail.hpp"
+#include "game.hpp"
+#include "memory.hpp"
+#include "pipeline.hpp"
+
+#include <chrono>
+#include <exception>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+namespace pipeline {
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        /// @returns Seconds since the time point which is moved to now
+        double lap(Clock::time_point& since) noexcept
+        {
+            const auto now = Clock::now();
+            const auto seconds = std::chrono::duration<double>(now - since).count();
+            since = now;
+            return seconds;
+        }
+
+        /// Represents the labyrinth which is ready to be played
+        struct Task {
+            size_t index;
+            std::shared_ptr<Fairyland> world;
+            double load;  //!< Seconds spent to parse the labyrinth
+        };
+
+        /// Represents the result of the played labyrinth
+        struct Done {
+            size_t index;
+            game::Result result;
+
+            Done() noexcept : index(0), result(game::Verdict::AlgorithmError, 0, std::string()) {}
+            Done(const size_t t_index, game::Result t_result) noexcept : index(t_index), result(std::move(t_result)) {}
+        };
+    }
+
+    /* Stage */
+
+    Stage::Stage(const char* t_name, const size_t t_threads) noexcept
+        : name(t_name), threads(t_threads), busy(0), waiting(0)
+    {}
+
+    /* Options */
+
+    Options::Options() noexcept
+        : loaders(1), solvers(1), capacity(64), flush(1 << 16), measure(false), tiered(false), statistics(nullptr)
+    {}
+
+    /* Functions */
+
+    bool readLabyrinth(std::istream& corpus, std::string& labyrinth)
+    {
+        labyrinth.clear();
+        std::string line;
+        while (std::getline(corpus, line)) {
+            const auto blank = line.find_first_not_of(" \t\r") == std::string::npos;
+            if (blank) {
+                if (labyrinth.empty()) {
+                    continue;
+                }
+                return true;
+            }
+            labyrinth.append(line);
+            labyrinth.push_back('\n');
+        }
+        return !labyrinth.empty();
+    }
+
+    std::vector<Stage> run(
+        std::istream& corpus,
+        std::ostream& output,
+        const Options& options,
+        const Format& format,
+        size_t& count)
+    {
+        Queue<Task> tasks(options.capacity);
+        Queue<Done> done(options.capacity);
+
+        std::vector<Stage> stages = {
+            Stage("loaders", options.loaders),
+            Stage("solvers", options.solvers),
+            Stage("writer", 1),
+        };
+        std::mutex stages_mutex;
+        const auto account = [&stages, &stages_mutex](const size_t stage, const double busy, const double waiting) {
+            std::lock_guard<std::mutex> lock(stages_mutex);
+            stages[stage].busy += busy;
+            stages[stage].waiting += waiting;
+        };
+
+        // The first error stops all stages and is thrown when threads are joined
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        const auto fail = [&](std::exception_ptr exception) {
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = exception;
+                }
+            }
+            tasks.close();
+            done.close();
+        };
+
+        // Loaders share the corpus, only the reading of text is serialized while parsing is done in parallel
+        std::mutex corpus_mutex;
+        size_t next_index = 0;
+        const auto load = [&]() {
+            double busy = 0;
+            double waiting = 0;
+            auto since = Clock::now();
+            try {
+                std::string labyrinth;
+                while (true) {
+                    size_t index = 0;
+                    {
+                        std::lock_guard<std::mutex> lock(corpus_mutex);
+                        if (!readLabyrinth(corpus, labyrinth)) {
+                            break;
+                        }
+                        index = next_index++;
+                    }
+                    std::istringstream input(labyrinth);
+                    auto world = std::make_shared<Fairyland>(input);
+                    const auto load = lap(since);
+                    busy += load;
+
+                    const auto pushed = tasks.push(Task{ index, std::move(world), load });
+                    waiting += lap(since);
+                    if (!pushed) {
+                        break;
+                    }
+                }
+            }
+            catch (...) {
+                fail(std::current_exception());
+            }
+            busy += lap(since);
+            account(0, busy, waiting);
+        };
+
+        const auto solve = [&](const size_t solver) {
+            double busy = 0;
+            double waiting = 0;
+            auto since = Clock::now();
+            try {
+                // Every solver has own arena, so solvers never share the global heap while they play
+                memory::Arena arena;
+                Task task{ 0, nullptr, 0 };
+                while (tasks.pop(task)) {
+                    waiting += lap(since);
+                    auto result = options.measure
+                        ? game::measure(task.world, arena, options.budget, options.tiered)
+                        : game::play(task.world, arena, options.budget, options.tiered);
+                    const auto play = lap(since);
+                    busy += play;
+                    if (options.statistics != nullptr) {
+                        options.statistics->getRecorder(solver).record(
+                            task.world->getWidth(), task.world->getHeight(), result, task.load, play);
+                    }
+                    task.world.reset();
+                    busy += lap(since);
+
+                    const auto pushed = done.push(Done(task.index, std::move(result)));
+                    waiting += lap(since);
+                    if (!pushed) {
+                        break;
+                    }
+                }
+            }
+            catch (...) {
+                fail(std::current_exception());
+            }
+            waiting += lap(since);
+            account(1, busy, waiting);
+        };
+
+        // Results come in any order, so they wait in the map until all previous are written
+        const auto write = [&]() {
+            double busy = 0;
+            double waiting = 0;
+            auto since = Clock::now();
+            try {
+                std::map<size_t, game::Result> pending;
+                std::string buffer;
+                size_t next = 0;
+                Done item;
+                while (done.pop(item)) {
+                    waiting += lap(since);
+                    pending.emplace(item.index, std::move(item.result));
+                    for (auto found = pending.find(next); found != pending.end(); found = pending.find(next)) {
+                        format(buffer, next, found->second);
+                        pending.erase(found);
+                        next += 1;
+                    }
+                    if (buffer.size() >= options.flush) {
+                        output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                        buffer.clear();
+                    }
+                    busy += lap(since);
+                }
+                output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                output.flush();
+                count = next;
+            }
+            catch (...) {
+                fail(std::current_exception());
+            }
+            busy += lap(since);
+            account(2, busy, waiting);
+        };
+
+        std::vector<std::thread> loaders;
+        for (size_t index = 0; index < stages[0].threads; ++index) {
+            loaders.emplace_back(load);
+        }
+        std::vector<std::thread> solvers;
+        for (size_t index = 0; index < stages[1].threads; ++index) {
+            solvers.emplace_back(solve, index);
+        }
+        std::thread writer(write);
+
+        // Every stage closes the queue of the next one when all its threads are over
+        for (auto& loader : loaders) {
+            loader.join();
+        }
+        tasks.close();
+        for (auto& solver : solvers) {
+            solver.join();
+        }
+        done.close();
+        writer.join();
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return stages;
+    }
+}
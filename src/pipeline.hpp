@@ -0,0 +1,121 @@
+#pragma once
+
+#include "game.hpp"
+#include "stats.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace pipeline {
+    /// Represents the bounded queue between two stages. Producer waits when the queue is full, so the faster stage
+    /// never runs far ahead of the slower one
+    template <typename T>
+    class Queue {
+    public:
+        explicit Queue(const size_t t_capacity) noexcept : m_capacity(t_capacity > 0 ? t_capacity : 1), m_closed(false)
+        {}
+
+    public:
+        /// Closes the queue. Consumers get items which are left and then Queue::pop returns false
+        void close() noexcept
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+            m_not_empty.notify_all();
+            m_not_full.notify_all();
+        }
+
+        /// Waits for the item
+        ///
+        /// @returns False when the queue is closed and empty
+        bool pop(T& item)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_not_empty.wait(lock, [this]() { return !m_items.empty() || m_closed; });
+            if (m_items.empty()) {
+                return false;
+            }
+            item = std::move(m_items.front());
+            m_items.pop_front();
+            m_not_full.notify_one();
+            return true;
+        }
+
+        /// Waits for the free place and adds the item
+        ///
+        /// @returns False when the queue is closed. In that case the item is dropped
+        bool push(T item)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_not_full.wait(lock, [this]() { return m_items.size() < m_capacity || m_closed; });
+            if (m_closed) {
+                return false;
+            }
+            m_items.push_back(std::move(item));
+            m_not_empty.notify_one();
+            return true;
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_not_empty;
+        std::condition_variable m_not_full;
+        std::deque<T> m_items;
+        size_t m_capacity;
+        bool m_closed;
+    };
+
+    /// Represents time which threads of one stage spent in total
+    struct Stage {
+        const char* name;  //!< Name of the stage which is used in the report
+        size_t threads;    //!< Amount of threads of the stage
+        double busy;       //!< Seconds of the own work of the stage
+        double waiting;    //!< Seconds of waiting for other stages: for input or for free place in the queue
+
+        Stage(const char* t_name, const size_t t_threads) noexcept;
+    };
+
+    /// Represents options of pipeline::run
+    struct Options {
+        size_t loaders;   //!< Threads which read and parse labyrinths
+        size_t solvers;   //!< Threads which play labyrinths
+        size_t capacity;  //!< Places of each queue
+        size_t flush;     //!< Bytes of the output which are collected before they are written at once
+        bool measure;     //!< True when solvers count turns saved by early verdicts (see game::measure)
+        graph::Budget budget;  //!< Limit of every search of pals (see game::Match::setBudget)
+        bool tiered;           //!< True when graphs keep cold blocks as tiles (see graph::Graph::setTiering)
+        stats::Statistics* statistics;  //!< Recorder for every solver or nullptr when nothing is recorded
+
+        Options() noexcept;
+    };
+
+    /// Formats the result of the labyrinth with the index into the output buffer
+    using Format = std::function<void(std::string& buffer, const size_t index, const game::Result& result)>;
+
+    /// Reads the next labyrinth of the corpus as is. Labyrinths in the corpus are separated by empty lines
+    ///
+    /// @returns False when the corpus has no more labyrinths
+    bool readLabyrinth(std::istream& corpus, std::string& labyrinth);
+
+    /// Plays all labyrinths of the corpus in three stages: loaders parse labyrinths into the bounded queue, solvers
+    /// play them and the writer puts results into the output in the corpus order
+    ///
+    /// @param count Amount of written results
+    ///
+    /// @returns Stages of loaders, solvers and the writer with their times
+    ///
+    /// @throws std::runtime_error when any labyrinth is invalid
+    std::vector<Stage> run(
+        std::istream& corpus,
+        std::ostream& output,
+        const Options& options,
+        const Format& format,
+        size_t& count);
+}
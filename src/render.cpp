@@ -0,0 +1,140 @@
+#include "graph.hpp"
+#include "render.hpp"
+
+#include <thread>
+#include <vector>
+
+namespace render {
+    /* Tile */
+
+    Tile::Tile(const int t_width, const int t_min_y, const int t_max_y) noexcept
+        : m_width(t_width),
+        m_min_y(t_min_y),
+        m_max_y(t_max_y),
+        m_cells(static_cast<size_t>(t_width * (t_max_y - t_min_y + 1)), '?')
+    {}
+
+    char* Tile::at(const graph::Position& pos) noexcept
+    {
+        if (pos.x < 0 || pos.x >= m_width || pos.y < m_min_y || pos.y > m_max_y) {
+            return nullptr;
+        }
+        return &m_cells[static_cast<size_t>((m_max_y - pos.y) * m_width + pos.x)];
+    }
+
+    void Tile::setPassage(const graph::Position& pos) noexcept
+    {
+        const auto cell = at(pos);
+        if (cell != nullptr && *cell != '#') {
+            *cell = '.';
+        }
+    }
+
+    void Tile::setStart(const graph::Position& pos, const char start) noexcept
+    {
+        const auto cell = at(pos);
+        if (cell != nullptr) {
+            *cell = start;
+        }
+    }
+
+    void Tile::setWall(const graph::Position& pos) noexcept
+    {
+        const auto cell = at(pos);
+        if (cell != nullptr) {
+            *cell = '#';
+        }
+    }
+
+    void Tile::write(std::ostream& output, const bool rle) const
+    {
+        for (size_t row = 0; row < m_cells.size(); row += m_width) {
+            if (!rle) {
+                output.write(&m_cells[row], m_width);
+                output.put('\n');
+                continue;
+            }
+
+            for (size_t begin = row, end = row; begin < row + m_width; begin = end) {
+                while (end < row + m_width && m_cells[end] == m_cells[begin]) {
+                    end += 1;
+                }
+                if (end - begin > 1) {
+                    output << end - begin;
+                }
+                output.put(m_cells[begin]);
+            }
+            output.put('\n');
+        }
+    }
+
+    /* Renderer */
+
+    Renderer::Renderer(
+        const graph::Graph& t_first,
+        const graph::Graph& t_second,
+        const char t_first_start,
+        const char t_second_start,
+        const int t_width,
+        const int t_height,
+        const size_t t_tile_rows,
+        const unsigned t_threads) noexcept
+        : m_first(t_first),
+        m_second(t_second),
+        m_first_start(t_first_start),
+        m_second_start(t_second_start),
+        m_width(t_width),
+        m_height(t_height),
+        m_tile_rows(static_cast<int>(t_tile_rows)),
+        m_threads(t_threads)
+    {
+        if (m_tile_rows <= 0) {
+            m_tile_rows = (1 << 20) / (m_width > 0 ? m_width : 1);
+            m_tile_rows = m_tile_rows > 0 ? m_tile_rows : 1;
+        }
+        if (m_threads == 0) {
+            m_threads = std::thread::hardware_concurrency();
+            m_threads = m_threads > 0 ? m_threads : 1;
+        }
+    }
+
+    void Renderer::write(std::ostream& output, const bool rle) const
+    {
+        std::vector<Tile> tiles;
+        for (int top = m_height - 1; top >= 0;) {
+            tiles.clear();
+            for (unsigned index = 0; index < m_threads && top >= 0; ++index) {
+                const auto bottom = top - m_tile_rows + 1 > 0 ? top - m_tile_rows + 1 : 0;
+                tiles.emplace_back(m_width, bottom, top);
+                top = bottom - 1;
+            }
+
+            // Small maps are one tile, so they are drawn without threads
+            if (tiles.size() == 1) {
+                rasterize(tiles.front());
+            }
+            else {
+                std::vector<std::thread> workers;
+                workers.reserve(tiles.size());
+                for (auto& tile : tiles) {
+                    workers.emplace_back([this, &tile]() { rasterize(tile); });
+                }
+                for (auto& worker : workers) {
+                    worker.join();
+                }
+            }
+
+            for (const auto& tile : tiles) {
+                tile.write(output, rle);
+            }
+        }
+    }
+
+    void Renderer::rasterize(Tile& tile) const noexcept
+    {
+        m_first.rasterize(tile);
+        m_second.rasterize(tile);
+        tile.setStart(m_first.getStart().lock()->m_position, m_first_start);
+        tile.setStart(m_second.getStart().lock()->m_position, m_second_start);
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "graph.hpp"
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+namespace render {
+    /// Represents the band of map rows [min_y; max_y] over the whole map width. Rows are kept from the upper one,
+    /// so the tile is written in the same order as the map is printed
+    class Tile {
+    public:
+        Tile(const int t_width, const int t_min_y, const int t_max_y) noexcept;
+
+    public:
+        /// Marks the cell as passage. Walls are never overwritten by passages, so graphs can be drawn in any order
+        void setPassage(const graph::Position& pos) noexcept;
+
+        /// Marks the cell as the start of the pal
+        void setStart(const graph::Position& pos, const char start) noexcept;
+
+        /// Marks the cell as wall
+        void setWall(const graph::Position& pos) noexcept;
+
+        /// Writes rows of the tile. When rle is true every run of several equal cells is written as the run
+        /// length followed by the cell, so "????##.." becomes "4?2#2."
+        void write(std::ostream& output, const bool rle) const;
+
+    private:
+        /// @returns Pointer to the cell or nullptr when position is out of the tile
+        char* at(const graph::Position& pos) noexcept;
+
+    private:
+        int m_width;
+        int m_min_y;
+        int m_max_y;
+        std::string m_cells;  //!< Rows of the tile without line breaks from max_y to min_y
+    };
+
+    /// Draws the map of two aligned graphs (see graph::Graph::alignWith) tile by tile. Tiles of one batch are
+    /// rasterized in parallel right from nodes of graphs and written in order, so only a few tiles are kept
+    /// in memory at once. Have O(n * tiles / threads) complexity
+    class Renderer {
+    public:
+        /// @param t_first The first graph which must be aligned with the second
+        /// @param t_second The second graph
+        /// @param t_first_start Char that represents the first graph start on the map
+        /// @param t_second_start Char that represents the second graph start on the map
+        /// @param t_width Width of the labyrinth
+        /// @param t_height Height of the labyrinth
+        /// @param t_tile_rows Rows per tile or 0 to use tiles about 1 MB size
+        /// @param t_threads Tiles which are rasterized at once or 0 to use all hardware threads
+        Renderer(
+            const graph::Graph& t_first,
+            const graph::Graph& t_second,
+            const char t_first_start,
+            const char t_second_start,
+            const int t_width,
+            const int t_height,
+            const size_t t_tile_rows = 0,
+            const unsigned t_threads = 0) noexcept;
+
+    public:
+        /// Writes the map from the upper row. Every row ends with the line break
+        void write(std::ostream& output, const bool rle = false) const;
+
+    private:
+        /// Draws passages and walls of both graphs and then their starts
+        void rasterize(Tile& tile) const noexcept;
+
+    private:
+        const graph::Graph& m_first;
+        const graph::Graph& m_second;
+        char m_first_start;
+        char m_second_start;
+        int m_width;
+        int m_height;
+        int m_tile_rows;
+        unsigned m_threads;
+    };
+}
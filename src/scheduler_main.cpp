@@ -0,0 +1,91 @@
+#include "coroutine.hpp"
+#include "fairy_tail.hpp"
+#include "game.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Reads all labyrinths of the corpus. Labyrinths in the corpus are separated by empty lines
+///
+/// @param path Path to the corpus file
+///
+/// @returns Worlds of every labyrinth in the same order
+std::vector<std::shared_ptr<Fairyland>> read_corpus(const char* path)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error(std::string("Corpus not found: ") + path);
+    }
+
+    std::vector<std::shared_ptr<Fairyland>> worlds;
+    while ((file >> std::ws).peek() != std::char_traits<char>::eof()) {
+        worlds.push_back(std::make_shared<Fairyland>(file));
+    }
+    return worlds;
+}
+
+int main(int argc, char** argv)
+{
+    // Usage: Volga-IT-Pathfinder-Scheduler [--games N] [--verify] corpus.txt
+    size_t window = 1024;
+    bool verify = false;
+    const char* corpus = nullptr;
+    for (int index = 1; index < argc; ++index) {
+        if (strcmp("--games", argv[index]) == 0 && index + 1 < argc) {
+            window = static_cast<size_t>(std::atoi(argv[++index]));
+        }
+        else if (strcmp("--verify", argv[index]) == 0) {
+            verify = true;
+        }
+        else {
+            corpus = argv[index];
+        }
+    }
+    if (corpus == nullptr || window == 0) {
+        std::cerr << "Usage: " << argv[0] << " [--games N] [--verify] corpus.txt" << std::endl;
+        return 1;
+    }
+
+    const auto worlds = read_corpus(corpus);
+
+    auto scheduler = coroutine::Scheduler(window);
+    const auto begin = std::chrono::steady_clock::now();
+    const auto results = scheduler.run(worlds);
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    for (size_t index = 0; index < results.size(); ++index) {
+        std::cout << index << ' ' << game::getVerdictName(results[index].verdict) << ' '
+            << results[index].turn_count << '\n';
+    }
+    const auto games = scheduler.getPeakGames();
+    std::cerr << results.size() << " labyrinths in " << elapsed * 1000 << " ms ("
+        << (elapsed > 0 ? results.size() * 60 / elapsed : 0) << " labyrinths per minute)" << std::endl;
+    std::cerr << "Peak games: " << games << ", " << (games > 0 ? scheduler.getPeakFrameBytes() / games : 0)
+        << " bytes of coroutine frame per game" << std::endl;
+
+    // Coroutines must give exactly the same results as the common game does
+    if (verify) {
+        const auto scalar_worlds = read_corpus(corpus);
+        size_t mismatches = 0;
+        for (size_t index = 0; index < scalar_worlds.size(); ++index) {
+            const auto expected = game::play(scalar_worlds[index]);
+            const auto& actual = results[index];
+            if (expected.verdict != actual.verdict
+                || expected.turn_count != actual.turn_count
+                || expected.message != actual.message
+                || expected.map != actual.map) {
+                std::cerr << "Mismatch at labyrinth " << index << std::endl;
+                mismatches += 1;
+            }
+        }
+        std::cerr << mismatches << " mismatches" << std::endl;
+        return mismatches == 0 ? 0 : 1;
+    }
+    return 0;
+}
@@ -0,0 +1,359 @@
+#include "fairy_tail.hpp"
+#include "game.hpp"
+#include "memory.hpp"
+#include "server.hpp"
+
+#include <condition_variable>
+#include <exception>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PATHFINDER_UNIX_SOCKETS
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace server {
+    namespace {
+        /// Index of the answer which tells the writer that the input is over
+        const size_t gInputOver = std::numeric_limits<size_t>::max();
+
+#ifdef PATHFINDER_UNIX_SOCKETS
+        /// @returns The address of the Unix domain socket at the path
+        ///
+        /// @throws std::runtime_error when the path is too long
+        sockaddr_un makeAddress(const std::string& path)
+        {
+            sockaddr_un address;
+            std::memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            if (path.size() >= sizeof(address.sun_path)) {
+                throw std::runtime_error("Socket path is too long: " + path);
+            }
+            std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+            return address;
+        }
+#endif
+    }
+
+    /* Server */
+
+    Server::Server(const size_t t_workers, const graph::Budget& t_budget) : m_budget(t_budget), m_jobs(t_workers * 4)
+    {
+        const auto workers = t_workers > 0 ? t_workers : 1;
+        for (size_t index = 0; index < workers; ++index) {
+            m_workers.emplace_back(&Server::work, this);
+        }
+    }
+
+    Server::~Server()
+    {
+        m_jobs.close();
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    size_t Server::serve(std::istream& input, std::ostream& output)
+    {
+        pipeline::Queue<Answer> answers(m_workers.size() * 4);
+
+        // Frames are read by another thread, so the next requests are solved while the response is written
+        std::exception_ptr error;
+        size_t requests = 0;
+        const auto read = [&]() {
+            try {
+                std::string labyrinth;
+                while (readFrame(input, labyrinth)) {
+                    m_jobs.push(Job{ requests, std::move(labyrinth), &answers });
+                    labyrinth = std::string();
+                    requests += 1;
+                }
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+            // The queue orders the count before this answer
+            answers.push(Answer{ gInputOver, std::string() });
+        };
+        std::thread reader(read);
+
+        // Answers come in any order, so they wait in the map until all previous are written
+        std::map<size_t, std::string> pending;
+        size_t next = 0;
+        auto total = gInputOver;
+        Answer answer{ 0, std::string() };
+        while (next != total && answers.pop(answer)) {
+            if (answer.index == gInputOver) {
+                total = requests;
+                continue;
+            }
+            pending.emplace(answer.index, std::move(answer.response));
+            for (auto found = pending.find(next); found != pending.end(); found = pending.find(next)) {
+                // The client which has gone away still gets nothing, while its requests are drained
+                if (output.good()) {
+                    writeFrame(output, found->second);
+                    output.flush();
+                }
+                pending.erase(found);
+                next += 1;
+            }
+        }
+        reader.join();
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return next;
+    }
+
+    void Server::work()
+    {
+        // The arena is reset by every game but keeps its chunks, so warm requests make no calls to the global heap
+        memory::Arena arena;
+        Job job{ 0, std::string(), nullptr };
+        while (m_jobs.pop(job)) {
+            auto response = solve(job.labyrinth, arena, m_budget);
+            job.answers->push(Answer{ job.index, std::move(response) });
+        }
+    }
+
+    /* Socket */
+
+    Socket::Socket(const int t_descriptor) noexcept : m_descriptor(t_descriptor)
+    {
+        setg(m_input, m_input, m_input);
+        setp(m_output, m_output + gBufferSize);
+    }
+
+    Socket::~Socket()
+    {
+#ifdef PATHFINDER_UNIX_SOCKETS
+        sync();
+        ::close(m_descriptor);
+#endif
+    }
+
+    std::unique_ptr<Socket> Socket::connect(const std::string& path)
+    {
+#ifdef PATHFINDER_UNIX_SOCKETS
+        const auto address = makeAddress(path);
+        const auto descriptor = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (descriptor < 0) {
+            throw std::runtime_error(std::string("Cannot create the socket: ") + std::strerror(errno));
+        }
+        if (::connect(descriptor, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            const auto reason = std::string(std::strerror(errno));
+            ::close(descriptor);
+            throw std::runtime_error("Cannot connect to " + path + ": " + reason);
+        }
+        return std::unique_ptr<Socket>(new Socket(descriptor));
+#else
+        throw std::runtime_error("Unix domain sockets are not supported: " + path);
+#endif
+    }
+
+    Socket::int_type Socket::overflow(int_type character)
+    {
+        if (sync() != 0) {
+            return traits_type::eof();
+        }
+        if (!traits_type::eq_int_type(character, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(character);
+            pbump(1);
+        }
+        return traits_type::not_eof(character);
+    }
+
+    int Socket::sync()
+    {
+#ifdef PATHFINDER_UNIX_SOCKETS
+        // The peer which has gone away must fail the stream instead of killing the process by SIGPIPE
+#ifdef MSG_NOSIGNAL
+        const int flags = MSG_NOSIGNAL;
+#else
+        const int flags = 0;
+#endif
+        for (auto begin = pbase(); begin < pptr();) {
+            const auto sent = ::send(m_descriptor, begin, static_cast<size_t>(pptr() - begin), flags);
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            }
+            if (sent <= 0) {
+                setp(m_output, m_output + gBufferSize);
+                return -1;
+            }
+            begin += sent;
+        }
+#endif
+        setp(m_output, m_output + gBufferSize);
+        return 0;
+    }
+
+    Socket::int_type Socket::underflow()
+    {
+#ifdef PATHFINDER_UNIX_SOCKETS
+        while (true) {
+            const auto received = ::read(m_descriptor, m_input, gBufferSize);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (received <= 0) {
+                return traits_type::eof();
+            }
+            setg(m_input, m_input, m_input + received);
+            return traits_type::to_int_type(*gptr());
+        }
+#else
+        return traits_type::eof();
+#endif
+    }
+
+    /* Functions */
+
+    bool readFrame(std::istream& input, std::string& payload)
+    {
+        unsigned char header[4];
+        if (!input.read(reinterpret_cast<char*>(header), 1)) {
+            return false;
+        }
+        if (!input.read(reinterpret_cast<char*>(header) + 1, 3)) {
+            throw std::runtime_error("Unexpected end of the frame header");
+        }
+
+        const auto size = static_cast<std::uint32_t>(header[0])
+            | static_cast<std::uint32_t>(header[1]) << 8
+            | static_cast<std::uint32_t>(header[2]) << 16
+            | static_cast<std::uint32_t>(header[3]) << 24;
+        if (size > gMaxPayload) {
+            throw std::runtime_error("Frame payload is too large: " + std::to_string(size));
+        }
+        payload.resize(size);
+        if (size > 0 && !input.read(&payload[0], size)) {
+            throw std::runtime_error("Unexpected end of the frame payload");
+        }
+        return true;
+    }
+
+    void writeFrame(std::ostream& output, const std::string& payload)
+    {
+        const auto size = static_cast<std::uint32_t>(payload.size());
+        const char header[4] = {
+            static_cast<char>(size & 0xFF),
+            static_cast<char>(size >> 8 & 0xFF),
+            static_cast<char>(size >> 16 & 0xFF),
+            static_cast<char>(size >> 24 & 0xFF),
+        };
+        output.write(header, sizeof(header));
+        output.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    }
+
+    std::string solve(const std::string& labyrinth, memory::Arena& arena, const graph::Budget& budget)
+    {
+        std::shared_ptr<Fairyland> world;
+        try {
+            std::istringstream input(labyrinth);
+            world = std::make_shared<Fairyland>(input);
+        }
+        catch (const std::exception& error) {
+            return std::string("invalid ") + error.what() + "\n";
+        }
+
+        std::string moves;
+        world->setLog(&moves);
+        auto result = game::Result(game::Verdict::AlgorithmError, 0, std::string());
+        try {
+            result = game::play(world, arena, budget);
+        }
+        catch (const std::exception& error) {
+            // The game was broken by the invalid advice, so its memory is not released by game::play
+            arena.reset();
+            result = game::Result(game::Verdict::AlgorithmError, world->getTurnCount(), error.what());
+        }
+
+        std::string response;
+        response.reserve(moves.size() + result.map.size() + 64);
+        response.append("verdict ").append(game::getVerdictName(result.verdict)).push_back('\n');
+        response.append("turns ").append(std::to_string(result.turn_count)).push_back('\n');
+        response.append("moves ").append(moves).push_back('\n');
+        if (result.verdict == game::Verdict::AlgorithmError) {
+            response.append("message ").append(result.message).push_back('\n');
+        }
+        if (budget.isLimited()) {
+            response.append("budget-hits ").append(std::to_string(result.budget_hits)).push_back('\n');
+        }
+        if (result.verdict == game::Verdict::Met && !result.map.empty()) {
+            response.append("map\n").append(result.map);
+        }
+        return response;
+    }
+
+    void listen(Server& server, const std::string& path)
+    {
+#ifdef PATHFINDER_UNIX_SOCKETS
+        const auto address = makeAddress(path);
+        const auto descriptor = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (descriptor < 0) {
+            throw std::runtime_error(std::string("Cannot create the socket: ") + std::strerror(errno));
+        }
+        ::unlink(path.c_str());
+        if (::bind(descriptor, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+            || ::listen(descriptor, 64) != 0) {
+            const auto reason = std::string(std::strerror(errno));
+            ::close(descriptor);
+            throw std::runtime_error("Cannot listen " + path + ": " + reason);
+        }
+
+        // Connections are served by detached threads, so the server must wait for them before it fails
+        std::mutex mutex;
+        std::condition_variable finished;
+        size_t connections = 0;
+        while (true) {
+            const auto client = ::accept(descriptor, nullptr, nullptr);
+            if (client < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                break;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                connections += 1;
+            }
+            std::thread([&server, &mutex, &finished, &connections, client]() {
+                {
+                    Socket socket(client);
+                    std::istream input(&socket);
+                    std::ostream output(&socket);
+                    try {
+                        server.serve(input, output);
+                    }
+                    catch (...) {
+                        // The broken frame closes only its connection
+                    }
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                connections -= 1;
+                finished.notify_all();
+            }).detach();
+        }
+
+        const auto reason = std::string(std::strerror(errno));
+        ::close(descriptor);
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&connections]() { return connections == 0; });
+        throw std::runtime_error("Cannot accept connections of " + path + ": " + reason);
+#else
+        (void)server;
+        throw std::runtime_error("Unix domain sockets are not supported: " + path);
+#endif
+    }
+}
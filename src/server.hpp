@@ -0,0 +1,130 @@
+#pragma once
+
+#include "graph.hpp"
+#include "memory.hpp"
+#include "pipeline.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Long-lived solver which answers labyrinth requests. Every request and response is a frame: the payload size as
+/// 4 bytes in little-endian order and then the payload. The request payload is the labyrinth as input.txt has it,
+/// the response payload is text lines:
+///
+///     verdict met|cannot-meet|error
+///     turns <turn count>
+///     moves <moves as output.txt has them without the final XX>
+///     message <error message>     (only for the error verdict)
+///     budget-hits <count>         (only when searches are limited by the budget)
+///     map                         (only when pals had met and the map was restored)
+///     <rows of the map>
+///
+/// The invalid labyrinth gets the only line "invalid <reason>"
+namespace server {
+    /// Represents the server with worker threads which keep their arenas between requests
+    class Server {
+    public:
+        /// @param t_workers Amount of worker threads
+        /// @param t_budget Limit of every search of pals, so every turn of a request is given in time
+        explicit Server(const size_t t_workers, const graph::Budget& t_budget = graph::Budget());
+        Server(const Server&) = delete;
+        Server& operator = (const Server&) = delete;
+
+        /// Waits until all workers are over. Streams must not be served any more
+        ~Server();
+
+    public:
+        /// Answers every frame of the input in the same order until the input is over. Responses are flushed one by
+        /// one, so the client may wait for each of them. Many streams may be served at once by different threads
+        ///
+        /// @returns Amount of answered requests
+        ///
+        /// @throws std::runtime_error when the frame is broken
+        size_t serve(std::istream& input, std::ostream& output);
+
+    private:
+        /// Represents the answered request
+        struct Answer {
+            size_t index;
+            std::string response;
+        };
+
+        /// Represents the request which waits for the worker
+        struct Job {
+            size_t index;
+            std::string labyrinth;
+            pipeline::Queue<Answer>* answers;  //!< Queue of the stream which the request came from
+        };
+
+        /// Solves jobs until the server is destroyed
+        void work();
+
+    private:
+        graph::Budget m_budget;
+        pipeline::Queue<Job> m_jobs;
+        std::vector<std::thread> m_workers;
+    };
+
+    /// Represents the stream buffer of the connected Unix domain socket. The socket is closed when the buffer is
+    /// destroyed
+    class Socket : public std::streambuf {
+    public:
+        /// @param t_descriptor Descriptor of the connected socket which is owned by the buffer since now
+        explicit Socket(const int t_descriptor) noexcept;
+        Socket(const Socket&) = delete;
+        Socket& operator = (const Socket&) = delete;
+        ~Socket() override;
+
+    public:
+        /// Connects to the socket which is served by server::listen
+        ///
+        /// @throws std::runtime_error when the connection fails or Unix domain sockets are not supported
+        static std::unique_ptr<Socket> connect(const std::string& path);
+
+    protected:
+        int_type overflow(int_type character) override;
+        int sync() override;
+        int_type underflow() override;
+
+    private:
+        static const size_t gBufferSize = 64 * 1024;
+
+        int m_descriptor;
+        char m_input[gBufferSize];
+        char m_output[gBufferSize];
+    };
+
+    /// Largest accepted payload. The frame is broken when it is larger
+    const std::uint32_t gMaxPayload = 64 * 1024 * 1024;
+
+    /// Reads the frame
+    ///
+    /// @returns False when the input is over before the frame
+    ///
+    /// @throws std::runtime_error when the input is over inside the frame or the payload is larger than gMaxPayload
+    bool readFrame(std::istream& input, std::string& payload);
+
+    /// Writes the frame
+    void writeFrame(std::ostream& output, const std::string& payload);
+
+    /// Plays the labyrinth and formats the response
+    ///
+    /// @param arena Arena for the solver memory which is reset when the game is over
+    /// @param budget Limit of every search of pals (see game::Match::setBudget)
+    std::string solve(
+        const std::string& labyrinth,
+        memory::Arena& arena,
+        const graph::Budget& budget = graph::Budget());
+
+    /// Serves every connection of the Unix domain socket by its own thread. The socket file is replaced
+    ///
+    /// @throws std::runtime_error when the socket cannot be listened or Unix domain sockets are not supported
+    void listen(Server& server, const std::string& path);
+}
@@ -0,0 +1,281 @@
+#include "bitboard.hpp"
+#include "game.hpp"
+#include "stats.hpp"
+
+#include <limits>
+
+namespace stats {
+    namespace {
+        /// @returns Nanoseconds of seconds
+        std::uint64_t toNanoseconds(const double seconds) noexcept
+        {
+            return seconds > 0 ? static_cast<std::uint64_t>(seconds * 1e9 + 0.5) : 0;
+        }
+
+        /// @returns True when the measure is the time in nanoseconds
+        bool isTime(const Measure measure) noexcept
+        {
+            return measure == Measure::Load || measure == Measure::Solve || measure == Measure::Restore;
+        }
+
+        /// @returns Index of the histogram of the measure of the class in Recorder
+        std::size_t getSlot(const Class type, const Measure measure) noexcept
+        {
+            return static_cast<std::size_t>(type) * static_cast<std::size_t>(Measure::Count)
+                + static_cast<std::size_t>(measure);
+        }
+    }
+
+    /* Histogram */
+
+    Histogram::Histogram()
+        : m_counts(new std::atomic<std::uint64_t>[gBuckets]),
+        m_count(0),
+        m_sum(0),
+        m_min(std::numeric_limits<std::uint64_t>::max()),
+        m_max(0)
+    {
+        for (int index = 0; index < gBuckets; ++index) {
+            m_counts[index].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    std::uint64_t Histogram::getCount() const noexcept
+    {
+        return m_count.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t Histogram::getMax() const noexcept
+    {
+        return m_max.load(std::memory_order_relaxed);
+    }
+
+    double Histogram::getMean() const noexcept
+    {
+        const auto count = getCount();
+        return count > 0 ? static_cast<double>(m_sum.load(std::memory_order_relaxed)) / count : 0;
+    }
+
+    std::uint64_t Histogram::getMin() const noexcept
+    {
+        return getCount() > 0 ? m_min.load(std::memory_order_relaxed) : 0;
+    }
+
+    std::uint64_t Histogram::getValueAt(const double percentile) const noexcept
+    {
+        // Buckets are summed instead of m_count, so the value is found even when the owner records right now
+        std::uint64_t total = 0;
+        for (int index = 0; index < gBuckets; ++index) {
+            total += m_counts[index].load(std::memory_order_relaxed);
+        }
+        if (total == 0) {
+            return 0;
+        }
+
+        const auto part = percentile < 0 ? 0 : percentile > 100 ? 100 : percentile;
+        auto rank = static_cast<std::uint64_t>(part / 100 * total + 0.5);
+        rank = rank > 0 ? rank : 1;
+
+        std::uint64_t seen = 0;
+        for (int index = 0; index < gBuckets; ++index) {
+            seen += m_counts[index].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                const auto highest = getHighest(index);
+                const auto max = getMax();
+                return highest < max ? highest : max;
+            }
+        }
+        return getMax();
+    }
+
+    void Histogram::merge(const Histogram& other) noexcept
+    {
+        for (int index = 0; index < gBuckets; ++index) {
+            const auto count = other.m_counts[index].load(std::memory_order_relaxed);
+            if (count != 0) {
+                m_counts[index].store(m_counts[index].load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+            }
+        }
+        m_count.store(getCount() + other.getCount(), std::memory_order_relaxed);
+        m_sum.store(
+            m_sum.load(std::memory_order_relaxed) + other.m_sum.load(std::memory_order_relaxed),
+            std::memory_order_relaxed);
+        if (other.getCount() > 0) {
+            const auto min = other.m_min.load(std::memory_order_relaxed);
+            if (min < m_min.load(std::memory_order_relaxed)) {
+                m_min.store(min, std::memory_order_relaxed);
+            }
+            const auto max = other.getMax();
+            if (max > getMax()) {
+                m_max.store(max, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void Histogram::record(const std::uint64_t value) noexcept
+    {
+        const auto index = getIndex(value < gMaxValue ? value : gMaxValue);
+        m_counts[index].store(m_counts[index].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        m_count.store(getCount() + 1, std::memory_order_relaxed);
+        m_sum.store(m_sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        if (value < m_min.load(std::memory_order_relaxed)) {
+            m_min.store(value, std::memory_order_relaxed);
+        }
+        if (value > getMax()) {
+            m_max.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    int Histogram::getIndex(const std::uint64_t value) noexcept
+    {
+        // Values below gSubBuckets are exact, every next power of two halves the precision
+        int bucket = 0;
+        for (auto rest = value >> gSubBucketBits; rest != 0; rest >>= 1) {
+            bucket += 1;
+        }
+        return bucket * gSubBuckets / 2 + static_cast<int>(value >> bucket);
+    }
+
+    std::uint64_t Histogram::getHighest(const int index) noexcept
+    {
+        const auto bucket = index < gSubBuckets ? 0 : index / (gSubBuckets / 2) - 1;
+        const auto sub = static_cast<std::uint64_t>(index - bucket * gSubBuckets / 2);
+        return ((sub + 1) << bucket) - 1;
+    }
+
+    /* Recorder */
+
+    Recorder::Recorder() {}
+
+    const Histogram& Recorder::getHistogram(const Class type, const Measure measure) const noexcept
+    {
+        return m_histograms[getSlot(type, measure)];
+    }
+
+    void Recorder::merge(const Recorder& other) noexcept
+    {
+        for (std::size_t index = 0; index < gHistograms; ++index) {
+            m_histograms[index].merge(other.m_histograms[index]);
+        }
+    }
+
+    void Recorder::record(
+        const std::size_t width,
+        const std::size_t height,
+        const game::Result& result,
+        const double load,
+        const double play) noexcept
+    {
+        // Labyrinths which fit the bitboard engine are played by it, so they are a class of their own
+        const auto small = bitboard::Pal<10, 10>::fits(width, height);
+        auto type = small ? Class::SmallError : Class::LargeError;
+        if (result.verdict == game::Verdict::Met) {
+            type = small ? Class::SmallMet : Class::LargeMet;
+        }
+        else if (result.verdict == game::Verdict::CannotMeet) {
+            type = small ? Class::SmallCannotMeet : Class::LargeCannotMeet;
+        }
+
+        const auto turns = result.turn_count > 0 ? result.turn_count : 0;
+        const auto solve = play > result.restore_time ? play - result.restore_time : 0;
+        const auto advices = result.advices > 0 ? result.advices : 0;
+        const auto restores = result.restores > 0 ? result.restores : 0;
+        m_histograms[getSlot(type, Measure::Turns)].record(static_cast<std::uint64_t>(turns));
+        m_histograms[getSlot(type, Measure::Load)].record(toNanoseconds(load));
+        m_histograms[getSlot(type, Measure::Solve)].record(toNanoseconds(solve));
+        m_histograms[getSlot(type, Measure::Restore)].record(toNanoseconds(result.restore_time));
+        m_histograms[getSlot(type, Measure::Nodes)].record(static_cast<std::uint64_t>(result.nodes));
+        m_histograms[getSlot(type, Measure::Advices)].record(static_cast<std::uint64_t>(advices));
+        m_histograms[getSlot(type, Measure::Restores)].record(static_cast<std::uint64_t>(restores));
+        m_histograms[getSlot(type, Measure::BudgetHits)].record(result.budget_hits);
+    }
+
+    /* Statistics */
+
+    Statistics::Statistics(const std::size_t threads)
+    {
+        for (std::size_t index = 0; index < threads; ++index) {
+            m_recorders.emplace_back(new Recorder());
+        }
+    }
+
+    Recorder& Statistics::getRecorder(const std::size_t thread) noexcept
+    {
+        return *m_recorders[thread];
+    }
+
+    std::unique_ptr<Recorder> Statistics::merge() const
+    {
+        auto merged = std::unique_ptr<Recorder>(new Recorder());
+        for (const auto& recorder : m_recorders) {
+            merged->merge(*recorder);
+        }
+        return merged;
+    }
+
+    /* Functions */
+
+    const char* getClassName(const Class type) noexcept
+    {
+        switch (type) {
+            case Class::SmallMet:
+                return "10x10 met";
+            case Class::SmallCannotMeet:
+                return "10x10 cannot-meet";
+            case Class::SmallError:
+                return "10x10 error";
+            case Class::LargeMet:
+                return "large met";
+            case Class::LargeCannotMeet:
+                return "large cannot-meet";
+            default:
+                return "large error";
+        }
+    }
+
+    const char* getMeasureName(const Measure measure) noexcept
+    {
+        switch (measure) {
+            case Measure::Turns:
+                return "turns";
+            case Measure::Load:
+                return "load us";
+            case Measure::Solve:
+                return "solve us";
+            case Measure::Restore:
+                return "restore us";
+            case Measure::Nodes:
+                return "nodes";
+            case Measure::Advices:
+                return "advices";
+            case Measure::Restores:
+                return "restores";
+            default:
+                return "budget hits";
+        }
+    }
+
+    void report(std::ostream& output, const Recorder& recorder)
+    {
+        static const double gPercentiles[] = { 50, 90, 99, 99.9 };
+
+        for (int type = 0; type < static_cast<int>(Class::Count); ++type) {
+            const auto labyrinths = recorder.getHistogram(static_cast<Class>(type), Measure::Turns).getCount();
+            if (labyrinths == 0) {
+                continue;
+            }
+            output << getClassName(static_cast<Class>(type)) << ": " << labyrinths << " labyrinths" << std::endl;
+
+            for (int measure = 0; measure < static_cast<int>(Measure::Count); ++measure) {
+                const auto& histogram = recorder.getHistogram(static_cast<Class>(type), static_cast<Measure>(measure));
+                const auto scale = isTime(static_cast<Measure>(measure)) ? 1e-3 : 1.0;
+                output << "  " << getMeasureName(static_cast<Measure>(measure))
+                    << ": mean " << histogram.getMean() * scale;
+                for (const auto percentile : gPercentiles) {
+                    output << ", p" << percentile << ' ' << histogram.getValueAt(percentile) * scale;
+                }
+                output << ", max " << histogram.getMax() * scale << std::endl;
+            }
+        }
+    }
+}
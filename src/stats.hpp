@@ -0,0 +1,156 @@
+#pragma once
+
+#include "game.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+/// Distributions of batch results. Every solver thread writes only its own Recorder, so recording takes no lock,
+/// while any thread can merge all recorders at any time. Memory depends only on the amount of recorders
+namespace stats {
+    /// Represents the measure of the played labyrinth
+    enum class Measure {
+        Turns,     //!< Turn count of the world at the end of the game
+        Load,      //!< Nanoseconds spent to parse the labyrinth
+        Solve,     //!< Nanoseconds spent to play the game without restoring the map
+        Restore,   //!< Nanoseconds spent to restore the map
+        Nodes,     //!< Nodes of both graphs at the end of the game
+        Advices,   //!< Advices given to both pals
+        Restores,  //!< Attempts to restore the map
+        BudgetHits,  //!< Searches of both pals paused by the budget
+        Count,
+    };
+
+    /// Represents the class of the labyrinth which has own distributions: its engine and the verdict
+    enum class Class {
+        SmallMet,
+        SmallCannotMeet,
+        SmallError,
+        LargeMet,
+        LargeCannotMeet,
+        LargeError,
+        Count,
+    };
+
+    /// Represents the histogram with log-linear buckets like HdrHistogram does: each power of two is split into
+    /// gSubBuckets / 2 linear buckets, so any value is kept within 1/32 of its magnitude in fixed memory.
+    /// Only one thread may record, while others may read or merge it at any time
+    class Histogram {
+    public:
+        Histogram();
+
+        Histogram(const Histogram&) = delete;
+        Histogram& operator = (const Histogram&) = delete;
+
+    public:
+        /// @returns Amount of recorded values
+        std::uint64_t getCount() const noexcept;
+
+        /// @returns The highest recorded value or 0
+        std::uint64_t getMax() const noexcept;
+
+        /// @returns Mean of recorded values or 0
+        double getMean() const noexcept;
+
+        /// @returns The lowest recorded value or 0
+        std::uint64_t getMin() const noexcept;
+
+        /// @param percentile Percent of values in [0; 100]
+        ///
+        /// @returns The highest value of the bucket which has the percentile or 0 when nothing was recorded.
+        /// The value is never higher than the highest recorded one
+        std::uint64_t getValueAt(const double percentile) const noexcept;
+
+        /// Adds all values of another histogram. Must be used by the thread which records this one
+        void merge(const Histogram& other) noexcept;
+
+        /// Records the value. Values above gMaxValue are counted in the last bucket, but the highest value is exact
+        void record(const std::uint64_t value) noexcept;
+
+    public:
+        static const int gSubBucketBits = 6;
+        static const int gSubBuckets = 1 << gSubBucketBits;
+        static const int gMaxValueBits = 40;
+        static const std::uint64_t gMaxValue = (std::uint64_t(1) << gMaxValueBits) - 1;
+        static const int gBuckets = (gMaxValueBits - gSubBucketBits + 1) * gSubBuckets / 2 + gSubBuckets / 2;
+
+    private:
+        /// @returns Index of the bucket which holds the value
+        static int getIndex(const std::uint64_t value) noexcept;
+
+        /// @returns The highest value which is held by the bucket
+        static std::uint64_t getHighest(const int index) noexcept;
+
+    private:
+        // Only the owner thread writes, so relaxed loads and stores are enough and readers never see torn values
+        std::unique_ptr<std::atomic<std::uint64_t>[]> m_counts;
+        std::atomic<std::uint64_t> m_count;
+        std::atomic<std::uint64_t> m_sum;
+        std::atomic<std::uint64_t> m_min;
+        std::atomic<std::uint64_t> m_max;
+    };
+
+    /// Represents histograms of every measure of every class which are written by one thread
+    class Recorder {
+    public:
+        Recorder();
+
+    public:
+        /// @returns Histogram of the measure of labyrinths of the class
+        const Histogram& getHistogram(const Class type, const Measure measure) const noexcept;
+
+        /// Adds all histograms of another recorder. Must be used by the thread which records this one
+        void merge(const Recorder& other) noexcept;
+
+        /// Records the played labyrinth
+        ///
+        /// @param width Width of the labyrinth
+        /// @param height Height of the labyrinth
+        /// @param result Result of the game
+        /// @param load Seconds spent to parse the labyrinth
+        /// @param play Seconds spent to play the game including restoring the map
+        void record(
+            const std::size_t width,
+            const std::size_t height,
+            const game::Result& result,
+            const double load,
+            const double play) noexcept;
+
+    private:
+        static const std::size_t gHistograms =
+            static_cast<std::size_t>(Class::Count) * static_cast<std::size_t>(Measure::Count);
+
+        Histogram m_histograms[gHistograms];
+    };
+
+    /// Represents recorders of all threads of the batch
+    class Statistics {
+    public:
+        /// @param threads Amount of threads which record labyrinths
+        explicit Statistics(const std::size_t threads);
+
+    public:
+        /// @returns Recorder of the thread. Only this thread may record it
+        Recorder& getRecorder(const std::size_t thread) noexcept;
+
+        /// @returns All recorders merged into one. May be used while threads record
+        std::unique_ptr<Recorder> merge() const;
+
+    private:
+        std::vector<std::unique_ptr<Recorder>> m_recorders;
+    };
+
+    /// @returns Name of the class which is used by reports: engine and verdict, for example "10x10 met"
+    const char* getClassName(const Class type) noexcept;
+
+    /// @returns Name of the measure which is used by reports. Times are named with their units
+    const char* getMeasureName(const Measure measure) noexcept;
+
+    /// Writes count, mean, percentiles 50, 90, 99, 99.9 and max of every measure of every class which has labyrinths.
+    /// Times are written in microseconds
+    void report(std::ostream& output, const Recorder& recorder);
+}